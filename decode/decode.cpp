@@ -1,43 +1,95 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <sstream>
 #include <streambuf>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "decode_formatter.h"
-#include "logger/compress/zlib_compress.h"
-#include "logger/compress/zstd_compress.h"
+#include "fmt/core.h"
+#include "logger/compress/compress.h"
 #include "logger/crypt/aes_crypt.h"
+#include "logger/crypt/aes_stream_crypt.h"
+#include "logger/formatter/compact_formatter.h"
 #include "logger/helpers/internal_log.h"
 #include "logger/sinks/effective_sink.h"
+#include "logger/utils/crc32c.h"
+#include "logger/utils/file_util.h"
+#include "zstd.h"
 
 using namespace logger;
 using namespace logger::detail;
 
 std::unique_ptr<DecodeFormatter> decode_formatter;
+// 命令行传入的zstd字典, 按字典id索引
+std::unordered_map<uint32_t, std::string> dictionaries;
 
-// 读取二进制文件到内存
-std::vector<char> ReadFile(const std::string& file_path) {
-  // 创建输入文件流对象，以二进制模式打开文件
-  std::ifstream ifs(file_path, std::ios::binary);
-  if (!ifs) {
-    LOG_ERROR("ReadFile: open file failed");
-    return {};
+// 命令行传入的过滤条件, 只输出时间范围内且不低于指定级别的记录
+struct DecodeFilter {
+  int64_t begin_time = std::numeric_limits<int64_t>::min();  // 微秒
+  int64_t end_time = std::numeric_limits<int64_t>::max();
+  int min_level = 0;
+
+  bool Active() const {
+    return begin_time != std::numeric_limits<int64_t>::min() || end_time != std::numeric_limits<int64_t>::max() ||
+           min_level > 0;
   }
-  // 定位到文件末尾以获取文件大小 将文件指针移动到文件末尾
-  // 第一个参数是偏移量（0表示不偏移）
-  // 第二个参数是基准位置（std::ios::end表示以文件末尾为基准）
-  ifs.seekg(0, std::ios::end);
-  // 获取文件大小（字节数）
-  // 返回当前文件指针的位置（即文件末尾的位置）
-  auto file_size = ifs.tellg();
-  // 重置文件指针到文件开头
-  ifs.seekg(0, std::ios::beg);
-  std::vector<char> buffer(file_size);
-  ifs.read(buffer.data(), file_size);
-  return buffer;
+};
+DecodeFilter decode_filter;
+// --samples指定时输出解密解压后的item内容(即sink送入压缩器的数据), 每项为[uint32长度][内容], 供dict_trainer训练字典
+std::ofstream sample_output;
+
+// 级别名(如Error, 与Formatter输出的级别名相同)转为LogLevel的值, 未知级别返回-1
+int ParseLevel(const std::string& name) {
+  static const char* kLevelNames[] = {"Trace", "Debug", "Info", "Warn", "Error", "Fatal"};
+  for (size_t level = 0; level < ChunkIndex::kLevels; ++level) {
+    std::string level_name = kLevelNames[level];
+    if (std::equal(level_name.begin(), level_name.end(), name.begin(), name.end(),
+                   [](char lhs, char rhs) { return std::tolower(lhs) == std::tolower(rhs); })) {
+      return static_cast<int>(level);
+    }
+  }
+  return -1;
+}
+
+// 本地时间(%Y%m%d%H%M%S, 与日志文件名中的时间格式相同)转为微秒时间戳, 格式错误返回false
+bool ParseTime(const std::string& text, int64_t& time) {
+  std::tm tm = {};
+  std::istringstream iss(text);
+  iss >> std::get_time(&tm, "%Y%m%d%H%M%S");
+  if (iss.fail()) {
+    return false;
+  }
+  tm.tm_isdst = -1;
+  time = static_cast<int64_t>(std::mktime(&tm)) * 1000000;
+  return true;
+}
+
+// 根据chunk索引判断是否有满足过滤条件的记录, 没有索引的chunk都需要解码
+bool ChunkMatches(const ChunkIndex& index) {
+  if (index.records == 0 || index.end_time < decode_filter.begin_time || index.begin_time > decode_filter.end_time) {
+    return false;
+  }
+  for (size_t level = std::max(decode_filter.min_level, 0); level < ChunkIndex::kLevels; ++level) {
+    if (index.levels[level] > 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool RecordMatches(const EffectiveMsg& msg) {
+  return msg.timestamp() >= decode_filter.begin_time && msg.timestamp() <= decode_filter.end_time &&
+         (decode_filter.min_level == 0 || ParseLevel(msg.level()) >= decode_filter.min_level);
 }
 
 void AppendDataToFile(const std::string& file_path, const std::string& data) {
@@ -45,104 +97,387 @@ void AppendDataToFile(const std::string& file_path, const std::string& data) {
   ofs.write(data.data(), data.size());
 }
 
-std::unique_ptr<logger::compress::Compression> decompress;
-
-void DecodeItemData(char* data, size_t size, logger::crypt::Crypt* crypt, std::string& output) {
+// 解密并解压item数据, 流式加密的chunk中各item必须按顺序解密
+std::string DecodeItemData(char* data,
+                           size_t size,
+                           logger::crypt::Crypt* crypt,
+                           logger::crypt::AESStreamCrypt* stream_crypt,
+                           logger::compress::Compression* decompress) {
+  if (!crypt) {
+    return decompress->Uncompress(data, size);
+  }
+  if (stream_crypt) {
+    std::string decrypted(data, size);
+    stream_crypt->Decrypt(decrypted.data(), decrypted.size());
+    return decompress->Uncompress(decrypted.data(), decrypted.size());
+  }
   std::string decrypted = crypt->Decrypt(data, size);
-  std::string decompressed = decompress->Uncompress(decrypted.data(), decrypted.size());
-  EffectiveMsg msg;
-  msg.ParseFromString(decompressed);
+  return decompress->Uncompress(decrypted.data(), decrypted.size());
+}
+
+void FormatMsg(const EffectiveMsg& msg, std::string& output) {
   std::string assemble;
   decode_formatter->Format(msg, assemble);
   output.append(assemble);
 }
 
+// 处理解密解压后的item, 批量压缩的一组item递归处理其中的每一项
+void DecodeItem(uint32_t magic,
+                const std::string& item,
+                formatter::CompactFormatter::SiteTable& site_table,
+                std::string& output) {
+  if (magic == ItemHeader::kGroupMagic) {
+    size_t offset = 0;
+    while (offset + sizeof(ItemHeader) <= item.size()) {
+      const ItemHeader* sub_header = reinterpret_cast<const ItemHeader*>(item.data() + offset);
+      offset += sizeof(ItemHeader);
+      if (offset + sub_header->size > item.size()) {
+        LOG_ERROR("DecodeItem: truncated group");
+        return;
+      }
+      DecodeItem(sub_header->magic, item.substr(offset, sub_header->size), site_table, output);
+      offset += sub_header->size;
+    }
+    return;
+  }
+  if (sample_output.is_open() && (magic == ItemHeader::kMagic || magic == ItemHeader::kSiteRecordMagic ||
+                                  magic == ItemHeader::kSiteTableMagic)) {
+    uint32_t sample_size = static_cast<uint32_t>(item.size());
+    sample_output.write(reinterpret_cast<const char*>(&sample_size), sizeof(sample_size));
+    sample_output.write(item.data(), item.size());
+  }
+  if (magic == ItemHeader::kDropMarkerMagic) {
+    if (item.size() < sizeof(DropMarker)) {
+      LOG_ERROR("DecodeItem: invalid drop marker");
+      return;
+    }
+    DropMarker marker;
+    memcpy(&marker, item.data(), sizeof(marker));
+    output.append(fmt::format("[Dropped] {} records dropped, {} low level records dropped, {} records overwritten\n",
+                              marker.dropped, marker.dropped_low_level, marker.overwritten));
+    return;
+  }
+  if (magic == ItemHeader::kSiteTableMagic) {
+    if (!formatter::CompactFormatter::ParseSiteTable(item, site_table)) {
+      LOG_ERROR("DecodeItem: invalid site table");
+    }
+    return;
+  }
+  EffectiveMsg msg;
+  if (magic == ItemHeader::kSiteRecordMagic) {
+    if (!formatter::CompactFormatter::ParseRecord(item, site_table, msg)) {
+      LOG_ERROR("DecodeItem: invalid site record");
+    }
+  } else {
+    msg.ParseFromString(item);
+  }
+  if (!RecordMatches(msg)) {
+    return;
+  }
+  FormatMsg(msg, output);
+  output.push_back('\n');  // 尾部插入换行
+}
+
 void DecodeChunkData(char* data,
                      size_t size,
                      const std::string& cli_pub_key,
                      const std::string& svr_pri_key,
                      const std::string& iv,
+                     crypt::CipherType cipher,
+                     compress::CompressType compress_type,
+                     uint32_t dict_id,
+                     uint16_t flags,
+                     const char* tag,
                      std::string& output) {
   std::cout << "decode chunk :" << size << std::endl;
-  // 服务器私钥
-  std::string svr_pri_key_bin = crypt::HexKeyToBinary(svr_pri_key);
-  // 计算共享密钥
-  std::string shared_secret = crypt::GenECDHSharedSecret(svr_pri_key_bin, cli_pub_key);
-  // 创建解压缩对象
-  std::unique_ptr<crypt::AESCrypt> crypt = std::make_unique<crypt::AESCrypt>(shared_secret);
-  // 设置IV
-  crypt->SetIV(iv);
+  std::unique_ptr<crypt::AESCrypt> crypt;
+  std::unique_ptr<crypt::AESStreamCrypt> stream_crypt;
+  if (cipher != crypt::CipherType::kNone) {
+    // 服务器私钥
+    std::string svr_pri_key_bin = crypt::HexKeyToBinary(svr_pri_key);
+    // 计算共享密钥
+    std::string shared_secret = crypt::GenECDHSharedSecret(svr_pri_key_bin, cli_pub_key);
+    // 创建解密对象
+    crypt = std::make_unique<crypt::AESCrypt>(shared_secret);
+    // 设置IV
+    crypt->SetIV(iv);
+    // CTR/GCM为chunk级流式加密
+    if (cipher == crypt::CipherType::kAesCtr || cipher == crypt::CipherType::kAesGcm) {
+      stream_crypt = std::make_unique<crypt::AESStreamCrypt>(shared_secret, cipher);
+      stream_crypt->DecryptInit(iv);
+    }
+  }
+  // 按chunk头部记录的压缩方式创建解压对象, 解压不需要压缩级别
+  auto decompress = compress::CreateCompression(compress_type, 0);
+  if (dict_id != 0) {
+    auto it = dictionaries.find(dict_id);
+    if (it == dictionaries.end() || !decompress->SetDictionary(it->second)) {
+      LOG_ERROR("DecodeChunkData: missing dictionary {}", dict_id);
+      return;
+    }
+  }
 
+  // 日志点表只在所属chunk内有效
+  formatter::CompactFormatter::SiteTable site_table;
+  size_t item_header_size = ItemHeader::Size(flags);
   size_t offset = 0;
   size_t count = 0;
-  while (offset < size) {
+  // item共用chunk内的压缩流和加密流, 某个item损坏后其后的item都无法正确解码, 放弃chunk的剩余部分
+  while (offset + item_header_size <= size) {
     ++count;
     if (count % 1000 == 0) {
       std::cout << "decode item " << count << std::endl;
     }
     ItemHeader* item_header = reinterpret_cast<ItemHeader*>(data + offset);
-    if (item_header->magic != ItemHeader::kMagic) {
-      LOG_ERROR("DecodeChunkData: invalid item magic");
+    if (item_header->magic != ItemHeader::kMagic && item_header->magic != ItemHeader::kSiteRecordMagic &&
+        item_header->magic != ItemHeader::kSiteTableMagic && item_header->magic != ItemHeader::kGroupMagic &&
+        item_header->magic != ItemHeader::kDropMarkerMagic && item_header->magic != ItemHeader::kChunkIndexMagic) {
+      LOG_ERROR("DecodeChunkData: invalid item magic, skip rest of chunk");
       return;
     }
     // 跳过ItemHeader
-    offset += sizeof(ItemHeader);
-    DecodeItemData(data + offset, item_header->size, crypt.get(), output);
+    offset += item_header_size;
+    if (item_header->size > size - offset) {
+      LOG_ERROR("DecodeChunkData: truncated item, skip rest of chunk");
+      return;
+    }
+    if (flags & ChunkHeader::kItemCrc) {
+      uint32_t crc;
+      memcpy(&crc, data + offset - sizeof(crc), sizeof(crc));
+      if (crc != ItemHeader::Checksum(*item_header, data + offset, item_header->size)) {
+        LOG_ERROR("DecodeChunkData: item checksum mismatch, skip rest of chunk");
+        return;
+      }
+    }
+    // 索引不使用chunk的压缩流和加密流(校验不通过时未被DecodeFile去掉)
+    if (item_header->magic == ItemHeader::kChunkIndexMagic) {
+      offset += item_header->size;
+      continue;
+    }
+    std::string item = DecodeItemData(data + offset, item_header->size, crypt.get(), stream_crypt.get(), decompress.get());
     // 跳到下一个ItemHeader
     offset += item_header->size;
-    output.push_back('\n');  // 尾部插入换行
+    DecodeItem(item_header->magic, item, site_table, output);
+  }
+  // GCM chunk校验完整性, 未正常结束的chunk(进程崩溃后恢复)没有tag
+  if (cipher == crypt::CipherType::kAesGcm) {
+    if (!tag) {
+      LOG_INFO("DecodeChunkData: chunk has no tag, integrity not verified");
+    } else if (!stream_crypt->DecryptFinal(tag)) {
+      LOG_ERROR("DecodeChunkData: chunk tag mismatch, data corrupted or tampered");
+    }
   }
 }
 
+// 从from开始查找下一个chunk头部, 用于跳过损坏的数据; 没有时返回file_size
+size_t FindNextChunk(std::ifstream& ifs, size_t from, size_t file_size) {
+  constexpr size_t kBlockSize = 1024 * 1024;
+  const uint64_t magic = ChunkHeader::kMagic;
+  const char* magic_begin = reinterpret_cast<const char*>(&magic);
+  std::vector<char> block;
+  while (from + sizeof(magic) <= file_size) {
+    block.resize(std::min(kBlockSize, file_size - from));
+    ifs.clear();
+    ifs.seekg(from);
+    if (!ifs.read(block.data(), block.size())) {
+      break;
+    }
+    auto it = std::search(block.begin(), block.end(), magic_begin, magic_begin + sizeof(magic));
+    if (it != block.end()) {
+      return from + (it - block.begin());
+    }
+    // 相邻两块之间保留magic长度减一的重叠
+    from += block.size() - (sizeof(magic) - 1);
+  }
+  return file_size;
+}
+
+// chunk数据之后是文件末尾或下一个chunk头部时, 认为头部中的size可信
+bool IsChunkBoundary(std::ifstream& ifs, size_t offset, size_t file_size) {
+  if (offset == file_size) {
+    return true;
+  }
+  uint64_t magic = 0;
+  ifs.clear();
+  ifs.seekg(offset);
+  if (offset + sizeof(magic) > file_size || !ifs.read(reinterpret_cast<char*>(&magic), sizeof(magic))) {
+    return false;
+  }
+  return ChunkHeader::HeaderSize(magic) != 0 && magic != ChunkHeader::kRawMagic;
+}
+
+// 校验chunk头部及item结构, items为不含ChunkHeader的chunk数据
+bool VerifyChunk(const ChunkHeader& chunk_header, const char* items, size_t size) {
+  size_t item_header_size = ItemHeader::Size(chunk_header.flags);
+  uint32_t items_crc = 0;
+  size_t offset = 0;
+  while (offset + item_header_size <= size) {
+    auto item_header = reinterpret_cast<const ItemHeader*>(items + offset);
+    items_crc = utils::Crc32c(items + offset + sizeof(ItemHeader), sizeof(uint32_t), items_crc);
+    offset += item_header_size;
+    if (item_header->size > size - offset) {
+      return false;
+    }
+    offset += item_header->size;
+  }
+  return offset == size && chunk_header.Checksum(items_crc) == chunk_header.crc;
+}
+
 void DecodeFile(const std::string& input_file_path, const std::string& pri_key, const std::string& output_file_path) {
-  // 取出文件中数据
-  auto input = ReadFile(input_file_path);
-  if (input.size() < sizeof(ChunkHeader)) {
-    LOG_ERROR("DecodeFile: input file is too small");
+  // 按chunk读取文件, 根据chunk索引跳过的chunk不读取数据
+  std::ifstream ifs(input_file_path, std::ios::binary);
+  if (!ifs) {
+    LOG_ERROR("DecodeFile: open file failed");
     return;
   }
-  // 得到文件头的chunk_header
-  auto chunk_header = reinterpret_cast<ChunkHeader*>(input.data());
-  // 判断魔数是否正确
-  if (chunk_header->magic != ChunkHeader::kMagic) {
-    LOG_ERROR("DecodeFile: invalid file magic");
+  ifs.seekg(0, std::ios::end);
+  size_t file_size = ifs.tellg();
+  if (file_size < sizeof(ChunkHeader)) {
+    LOG_ERROR("DecodeFile: input file is too small");
     return;
   }
   size_t offset = 0;
-  size_t file_size = input.size();
+  std::vector<char> data;
   std::string output;
   output.reserve(1024 * 1024);
+  // 头部损坏的chunk无法确定边界, 从其后查找下一个chunk头部继续解码
+  auto resync = [&](size_t chunk_offset) {
+    size_t next = FindNextChunk(ifs, chunk_offset + 1, file_size);
+    LOG_ERROR("DecodeFile: skip {} corrupted bytes at offset {}", next - chunk_offset, chunk_offset);
+    return next;
+  };
   while (offset < file_size) {
-    ChunkHeader* chunk_header = reinterpret_cast<ChunkHeader*>(input.data() + offset);
-    if (chunk_header->magic != ChunkHeader::kMagic) {
+    ChunkHeader chunk_header;
+    size_t chunk_offset = offset;
+    ifs.clear();
+    ifs.seekg(offset);
+    // 旧格式头部比ChunkHeader短, 先读magic确定头部长度
+    if (offset + sizeof(chunk_header.magic) > file_size ||
+        !ifs.read(reinterpret_cast<char*>(&chunk_header.magic), sizeof(chunk_header.magic))) {
+      LOG_ERROR("DecodeFile: truncated chunk header");
+      return;
+    }
+    size_t header_size = ChunkHeader::HeaderSize(chunk_header.magic);
+    if (header_size == 0 || chunk_header.magic == ChunkHeader::kRawMagic) {
       LOG_ERROR("DecodeFile: invalid chunk magic");
+      offset = resync(chunk_offset);
+      continue;
+    }
+    if (offset + header_size > file_size ||
+        !ifs.read(reinterpret_cast<char*>(&chunk_header) + sizeof(chunk_header.magic),
+                  header_size - sizeof(chunk_header.magic))) {
+      LOG_ERROR("DecodeFile: truncated chunk header");
       return;
     }
+    offset += header_size;
+    if (chunk_header.size > file_size - offset) {
+      LOG_ERROR("DecodeFile: truncated chunk");
+      offset = resync(chunk_offset);
+      continue;
+    }
+    // 旧格式chunk只有zstd压缩与CBC加密, 没有cipher/compress/flags字段
+    bool legacy = chunk_header.magic == ChunkHeader::kLegacyMagic;
+    uint16_t flags = legacy ? 0 : chunk_header.flags;
+    // 带索引的chunk先读末尾的索引(有item校验时已校验), 没有满足条件的记录时直接跳过
+    size_t index_size = ChunkIndex::ItemSize(flags);
+    if (decode_filter.Active() && (flags & ChunkHeader::kHasIndex) && chunk_header.size >= index_size) {
+      data.resize(index_size);
+      ifs.seekg(offset + chunk_header.size - index_size);
+      ifs.read(data.data(), data.size());
+      // 加密的索引用chunk的共享密钥解密
+      std::string key;
+      if (flags & ChunkHeader::kIndexEncrypted) {
+        key = crypt::GenECDHSharedSecret(crypt::HexKeyToBinary(pri_key), std::string(chunk_header.pub_key, 65));
+      }
+      ChunkIndex index;
+      if (ChunkIndex::Find(flags, data.data(), data.size(), key, index)) {
+        if (!ChunkMatches(index)) {
+          std::cout << "skip chunk :" << chunk_header.size << std::endl;
+          offset += chunk_header.size;
+          continue;
+        }
+      }
+      ifs.seekg(offset);
+    }
+    data.resize(chunk_header.size);
+    if (!ifs.read(data.data(), data.size())) {
+      LOG_ERROR("DecodeFile: read chunk failed");
+      return;
+    }
+    // 只有size不可信时才无法确定chunk边界; 否则解码到第一个损坏的item为止, 保留其前的记录
+    if ((flags & ChunkHeader::kHasCrc) && !VerifyChunk(chunk_header, data.data(), data.size())) {
+      if (!IsChunkBoundary(ifs, offset + chunk_header.size, file_size)) {
+        LOG_ERROR("DecodeFile: invalid chunk size");
+        offset = resync(chunk_offset);
+        continue;
+      }
+      LOG_ERROR("DecodeFile: chunk checksum mismatch, decode until the first corrupted item");
+    }
+    crypt::CipherType cipher = legacy ? crypt::CipherType::kAesCbc : chunk_header.cipher;
+    compress::CompressType compress_type = legacy ? compress::CompressType::kZstd : chunk_header.compress;
+    uint32_t dict_id = legacy ? 0 : chunk_header.dict_id;
+    const char* tag = (flags & ChunkHeader::kHasTag) ? chunk_header.tag : nullptr;
     output.clear();
-    // 跳至数据
-    offset += sizeof(ChunkHeader);
-    DecodeChunkData(input.data() + offset, chunk_header->size, std::string(chunk_header->pub_key, 65), pri_key,
-                    chunk_header->iv, output);
+    DecodeChunkData(data.data(), data.size(), std::string(chunk_header.pub_key, 65), pri_key,
+                    std::string(chunk_header.iv, sizeof(chunk_header.iv)), cipher, compress_type, dict_id, flags, tag,
+                    output);
     // 跳至下一ChunkHeader
-    offset += chunk_header->size;
+    offset += chunk_header.size;
     // 数据输出到文件
     AppendDataToFile(output_file_path, output);
   }
 }
 
 int main(int argc, char* argv[]) {
-  // ./decode <file_path> <pri_key> <output_file>
-  if (argc != 4) {
-    std::cerr << "Usage: ./decode <file_path> <pri_key> <output_file>" << std::endl;
+  // ./decode <file_path> <pri_key> <output_file> [dict_file...] [--from=时间] [--to=时间] [--level=级别]
+  //          [--samples=文件]
+  // 时间为本地时间%Y%m%d%H%M%S, 级别为Trace/Debug/Info/Warn/Error/Fatal; 样本文件追加写入
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    bool ok = true;
+    if (arg.rfind("--from=", 0) == 0) {
+      ok = ParseTime(arg.substr(7), decode_filter.begin_time);
+    } else if (arg.rfind("--to=", 0) == 0) {
+      // 包含结束时间所在的整秒
+      ok = ParseTime(arg.substr(5), decode_filter.end_time);
+      decode_filter.end_time += 999999;
+    } else if (arg.rfind("--level=", 0) == 0) {
+      decode_filter.min_level = ParseLevel(arg.substr(8));
+      ok = decode_filter.min_level >= 0;
+    } else if (arg.rfind("--samples=", 0) == 0) {
+      sample_output.open(arg.substr(10), std::ios::binary | std::ios::app);
+      ok = sample_output.is_open();
+    } else {
+      args.push_back(arg);
+    }
+    if (!ok) {
+      std::cerr << "invalid option: " << arg << std::endl;
+      return 1;
+    }
+  }
+  if (args.size() < 3) {
+    std::cerr << "Usage: ./decode <file_path> <pri_key> <output_file> [dict_file...] [--from=%Y%m%d%H%M%S] "
+                 "[--to=%Y%m%d%H%M%S] [--level=Error] [--samples=file]"
+              << std::endl;
     return 1;
   }
-  std::string input_file_path = argv[1];
-  std::string pri_key = argv[2];
-  std::string output_file_path = argv[3];
+  std::string input_file_path = args[0];
+  std::string pri_key = args[1];
+  std::string output_file_path = args[2];
+  // 日志使用了字典压缩时需要传入对应的字典文件
+  for (size_t i = 3; i < args.size(); ++i) {
+    std::string dict = logger::filesystem::ReadFile(args[i]);
+    uint32_t dict_id = ZSTD_getDictID_fromDict(dict.data(), dict.size());
+    if (dict_id == 0) {
+      std::cerr << "invalid dictionary: " << args[i] << std::endl;
+      return 1;
+    }
+    dictionaries[dict_id] = std::move(dict);
+  }
 
   decode_formatter = std::make_unique<DecodeFormatter>();
   decode_formatter->SetPattern("[%l][%D:%S][%p:%t][%F:%f:%#]%v");
-  decompress = std::make_unique<logger::compress::ZstdCompression>();
   DecodeFile(input_file_path, pri_key, output_file_path);
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "zdict.h"
+
+// 训练zstd字典, 样本为decoder --samples输出的item内容(序列化后的记录和日志点表), 与sink压缩的数据一致
+// 训练得到的字典通过EffectiveSink::Conf::dict_path加载, 解码时作为decoder的附加参数传入
+
+int main(int argc, char* argv[]) {
+  // ./dict_trainer <dict_file> <dict_size_kb> <sample_file...>
+  if (argc < 4) {
+    std::cerr << "Usage: ./dict_trainer <dict_file> <dict_size_kb> <sample_file...>" << std::endl;
+    return 1;
+  }
+  std::string dict_file_path = argv[1];
+  size_t dict_capacity = std::stoul(argv[2]) * 1024;
+
+  // 样本连续存放, 另记每个样本的长度
+  std::string samples;
+  std::vector<size_t> sample_sizes;
+  for (int i = 3; i < argc; ++i) {
+    std::ifstream ifs(argv[i], std::ios::binary);
+    if (!ifs) {
+      std::cerr << "open " << argv[i] << " failed" << std::endl;
+      return 1;
+    }
+    // 每项为[uint32长度][内容]
+    uint32_t sample_size = 0;
+    while (ifs.read(reinterpret_cast<char*>(&sample_size), sizeof(sample_size))) {
+      std::string sample(sample_size, '\0');
+      if (!ifs.read(sample.data(), sample.size())) {
+        std::cerr << "truncated sample in " << argv[i] << std::endl;
+        return 1;
+      }
+      if (sample.empty()) {
+        continue;
+      }
+      samples.append(sample);
+      sample_sizes.push_back(sample.size());
+    }
+  }
+  std::cout << "samples: " << sample_sizes.size() << ", bytes: " << samples.size() << std::endl;
+
+  std::string dict(dict_capacity, '\0');
+  size_t dict_size = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(), sample_sizes.data(),
+                                           static_cast<unsigned>(sample_sizes.size()));
+  if (ZDICT_isError(dict_size)) {
+    std::cerr << "train dictionary failed: " << ZDICT_getErrorName(dict_size) << std::endl;
+    return 1;
+  }
+  dict.resize(dict_size);
+
+  std::ofstream ofs(dict_file_path, std::ios::binary);
+  ofs.write(dict.data(), dict.size());
+  std::cout << "dictionary id: " << ZDICT_getDictID(dict.data(), dict.size()) << ", size: " << dict.size()
+            << std::endl;
+  return 0;
+}
@@ -0,0 +1,91 @@
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger/crypt/crypt.h"
+#include "logger/log.h"
+#include "logger/mmap/mmapper.h"
+#include "logger/sinks/effective_sink.h"
+#include "logger/variadic_logger.h"
+
+// mmap缓存段映射选项的对比: 记录期间调用线程上的缺页次数以及单次Log的p50/p99/p999耗时
+// 用法: ./cache_fault_bench [cache_dir], 目录放在tmpfs上时kHugePage才可能生效
+
+using logger::mmap::MMapper;
+
+struct OptionCase {
+  const char* name;
+  uint32_t options;
+};
+
+constexpr int kRecords = 200000;
+
+static long MinorFaults() {
+  struct rusage usage;
+  getrusage(RUSAGE_THREAD, &usage);
+  return usage.ru_minflt;
+}
+
+struct Result {
+  long faults;
+  std::vector<double> latencies;
+};
+
+static Result RunCase(const std::filesystem::path& dir, const std::string& pub_key, uint32_t options) {
+  std::filesystem::remove_all(dir);
+  logger::sink::EffectiveSink::Conf conf;
+  conf.dir = dir;
+  conf.prefix = "bench";
+  conf.pub_key = pub_key;
+  conf.cache_options = options;
+
+  Result result;
+  result.latencies.resize(kRecords);
+  {
+    auto sink = std::make_shared<logger::sink::EffectiveSink>(conf);
+    auto log = std::make_shared<logger::VariadicLogger>(sink);
+    long faults_begin = MinorFaults();
+    for (int i = 0; i < kRecords; ++i) {
+      auto begin = std::chrono::steady_clock::now();
+      LOG_LOGGER_INFO(log, "request {} from user {} took {} ms, status {}", i, "bench_user", i % 97, "ok");
+      auto end = std::chrono::steady_clock::now();
+      result.latencies[i] = std::chrono::duration<double, std::nano>(end - begin).count();
+    }
+    result.faults = MinorFaults() - faults_begin;
+    log->Flush();
+  }
+  std::filesystem::remove_all(dir);
+  std::sort(result.latencies.begin(), result.latencies.end());
+  return result;
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path base_dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path().string();
+  std::filesystem::path dir = base_dir / "cache_fault_bench";
+  auto [server_private_key, server_public_key] = logger::crypt::GenECDHKey();
+  std::string pub_key = logger::crypt::BinaryKeyToHex(server_public_key);
+  std::vector<OptionCase> option_cases = {
+      {"default", 0},
+      {"populate", MMapper::kPopulate},
+      {"sequential", MMapper::kSequential},
+      {"hugepage", MMapper::kHugePage},
+      {"populate+huge", MMapper::kPopulate | MMapper::kHugePage},
+  };
+
+  // 预热一轮, 排除堆、格式化缓冲区等首次分配产生的缺页
+  RunCase(dir, pub_key, 0);
+  printf("%-14s %10s %10s %10s %10s %10s\n", "options", "faults", "p50 ns", "p99 ns", "p999 ns", "max us");
+  for (auto& option_case : option_cases) {
+    Result result = RunCase(dir, pub_key, option_case.options);
+    auto& latencies = result.latencies;
+    printf("%-14s %10ld %10.0f %10.0f %10.0f %10.1f\n", option_case.name, result.faults, latencies[kRecords / 2],
+           latencies[kRecords * 99 / 100], latencies[kRecords * 999 / 1000], latencies.back() / 1000);
+  }
+  return 0;
+}
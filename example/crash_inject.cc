@@ -0,0 +1,246 @@
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/compress/compress.h"
+#include "logger/log.h"
+#include "logger/sinks/effective_sink.h"
+#include "logger/utils/crc32c.h"
+#include "logger/variadic_logger.h"
+
+// 崩溃注入: 子进程持续写日志, 父进程在随机时刻SIGKILL子进程, 重复多轮(子进程启动时恢复上一轮的缓存)
+// 最后由父进程恢复一次并正常关闭, 然后逐个chunk检查日志文件:
+//  - chunk结构完整, item和chunk的CRC32C校验通过, 每个item都能解压
+//  - 每轮的记录序号从0开始连续(批量模式下未写入缓存的批次在末尾丢失, 不算缺失)
+//  - 只允许文件末尾出现不完整的chunk(写文件时被杀死), 重复的记录(写完文件后释放缓存段前被杀死)只统计
+// 不加密以便直接解压检查, 加密不影响chunk和item的结构
+// 用法: ./crash_inject [log_dir] [rounds] [max_delay_ms]
+
+using logger::detail::ChunkHeader;
+using logger::detail::ItemHeader;
+
+constexpr int kMaxRecordsPerRound = 100000;
+constexpr char kRecordTag[] = "crash-inject round ";
+
+struct VerifyResult {
+  size_t files{0};
+  size_t chunks{0};
+  size_t torn_tails{0};      // 文件末尾不完整的chunk
+  size_t corrupt_chunks{0};  // 文件中间的无效数据、校验不通过或不能解压的chunk
+  size_t records{0};
+  size_t duplicates{0};
+  size_t gaps{0};
+};
+
+logger::sink::EffectiveSink::Conf MakeConf(const std::filesystem::path& dir, int round) {
+  logger::sink::EffectiveSink::Conf conf;
+  conf.dir = dir;
+  conf.prefix = "crash";
+  conf.cipher = logger::crypt::CipherType::kNone;
+  conf.single_size = logger::megabytes(1);
+  conf.total_size = logger::megabytes(4096);
+  conf.segment_size = logger::kilobytes(256);
+  // 轮流使用逐条压缩、批量压缩和raw缓存, 上一轮遗留的缓存可能是另一种格式
+  if (round % 3 == 1) {
+    conf.batch_size = logger::kilobytes(16);
+  } else if (round % 3 == 2) {
+    conf.raw_cache = true;
+  }
+  return conf;
+}
+
+[[noreturn]] void RunChild(const std::filesystem::path& dir, int round) {
+  {
+    auto sink = std::make_shared<logger::sink::EffectiveSink>(MakeConf(dir, round));
+    auto log = std::make_shared<logger::VariadicLogger>(sink);
+    for (int i = 0; i < kMaxRecordsPerRound; ++i) {
+      LOG_LOGGER_INFO(log, "crash-inject round {} seq {} payload {}", round, i, i * 2654435761u);
+    }
+    // 写完仍未被杀死时保持存活, 让父进程在后台写文件期间杀死
+    pause();
+  }
+  _exit(0);
+}
+
+// 在记录的明文中找出轮次和序号
+void CollectRecord(const std::string& record, std::map<int, std::vector<int>>& seqs) {
+  auto pos = record.find(kRecordTag);
+  if (pos == std::string::npos) {
+    return;
+  }
+  int round = 0;
+  int seq = 0;
+  if (sscanf(record.c_str() + pos + sizeof(kRecordTag) - 1, "%d seq %d", &round, &seq) == 2) {
+    seqs[round].push_back(seq);
+  }
+}
+
+// 校验并解压一个chunk, 成功时收集其中的记录
+bool VerifyChunk(const ChunkHeader& header, const char* data, size_t size, std::map<int, std::vector<int>>& seqs) {
+  bool checked = header.flags & ChunkHeader::kItemCrc;
+  size_t item_header_size = ItemHeader::Size(header.flags);
+  auto decompress = logger::compress::CreateCompression(header.compress, 0);
+  std::map<int, std::vector<int>> chunk_seqs;
+  uint32_t items_crc = 0;
+  size_t offset = 0;
+  while (offset < size) {
+    if (size - offset < item_header_size) {
+      return false;
+    }
+    auto item_header = reinterpret_cast<const ItemHeader*>(data + offset);
+    const char* item = data + offset + item_header_size;
+    if (!ItemHeader::IsValidMagic(item_header->magic) || item_header->size > size - offset - item_header_size) {
+      return false;
+    }
+    offset += item_header_size + item_header->size;
+    if (checked) {
+      uint32_t crc;
+      memcpy(&crc, item - sizeof(crc), sizeof(crc));
+      if (crc != ItemHeader::Checksum(*item_header, item, item_header->size)) {
+        return false;
+      }
+      items_crc = logger::utils::Crc32c(&crc, sizeof(crc), items_crc);
+    }
+    if (item_header->magic == ItemHeader::kChunkIndexMagic) {
+      continue;
+    }
+    std::string plain = decompress->Uncompress(item, item_header->size);
+    if (plain.empty()) {
+      return false;
+    }
+    if (item_header->magic == ItemHeader::kMagic || item_header->magic == ItemHeader::kSiteRecordMagic) {
+      CollectRecord(plain, chunk_seqs);
+    }
+    if (item_header->magic != ItemHeader::kGroupMagic) {
+      continue;
+    }
+    // group item解压后为item序列
+    for (size_t group_offset = 0; group_offset + sizeof(ItemHeader) <= plain.size();) {
+      auto group_item = reinterpret_cast<const ItemHeader*>(plain.data() + group_offset);
+      group_offset += sizeof(ItemHeader);
+      if (group_item->size > plain.size() - group_offset) {
+        return false;
+      }
+      if (group_item->magic == ItemHeader::kMagic || group_item->magic == ItemHeader::kSiteRecordMagic) {
+        CollectRecord(plain.substr(group_offset, group_item->size), chunk_seqs);
+      }
+      group_offset += group_item->size;
+    }
+  }
+  if ((header.flags & ChunkHeader::kHasCrc) && header.crc != header.Checksum(items_crc)) {
+    return false;
+  }
+  for (auto& [round, round_seqs] : chunk_seqs) {
+    seqs[round].insert(seqs[round].end(), round_seqs.begin(), round_seqs.end());
+  }
+  return true;
+}
+
+// 从offset开始查找下一个chunk头部
+size_t FindNextChunk(const std::string& input, size_t offset) {
+  const char* magic = reinterpret_cast<const char*>(&ChunkHeader::kMagic);
+  auto iter = std::search(input.begin() + offset, input.end(), magic, magic + sizeof(ChunkHeader::kMagic));
+  return iter - input.begin();
+}
+
+VerifyResult Verify(const std::filesystem::path& dir) {
+  VerifyResult result;
+  std::map<int, std::vector<int>> seqs;
+  for (auto& entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() != ".log") {
+      continue;
+    }
+    ++result.files;
+    std::ifstream ifs(entry.path(), std::ios::binary);
+    std::string input((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    size_t offset = 0;
+    while (offset < input.size()) {
+      auto header = reinterpret_cast<const ChunkHeader*>(input.data() + offset);
+      size_t remaining = input.size() - offset;
+      bool complete = remaining >= sizeof(ChunkHeader) && header->magic == ChunkHeader::kMagic &&
+                      header->size <= remaining - sizeof(ChunkHeader);
+      if (complete && VerifyChunk(*header, input.data() + offset + sizeof(ChunkHeader), header->size, seqs)) {
+        ++result.chunks;
+        offset += sizeof(ChunkHeader) + header->size;
+        continue;
+      }
+      // 跳到下一个chunk, 之后没有chunk时为文件末尾被截断的chunk
+      size_t next = FindNextChunk(input, offset + 1);
+      if (next == input.size() && !complete) {
+        ++result.torn_tails;
+      } else {
+        ++result.corrupt_chunks;
+        printf("corrupt chunk in %s at offset %zu\n", entry.path().filename().c_str(), offset);
+      }
+      offset = next;
+    }
+  }
+  for (auto& [round, round_seqs] : seqs) {
+    std::sort(round_seqs.begin(), round_seqs.end());
+    size_t unique = std::unique(round_seqs.begin(), round_seqs.end()) - round_seqs.begin();
+    result.duplicates += round_seqs.size() - unique;
+    result.records += unique;
+    round_seqs.resize(unique);
+    // 序号从0开始连续, 缺失的个数即最大序号+1与实际个数之差
+    size_t gaps = round_seqs.back() + 1 - unique;
+    if (gaps > 0) {
+      printf("round %d: %zu records missing before seq %d\n", round, gaps, round_seqs.back());
+    }
+    result.gaps += gaps;
+  }
+  return result;
+}
+
+int main(int argc, char** argv) {
+  std::filesystem::path base_dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path().string();
+  int rounds = argc > 2 ? atoi(argv[2]) : 50;
+  int max_delay_ms = argc > 3 ? atoi(argv[3]) : 200;
+  std::filesystem::path dir = base_dir / "crash_inject";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  // 父进程在所有子进程结束前不创建sink, fork时只有一个线程
+  std::mt19937 rng(std::random_device{}());
+  std::uniform_int_distribution<int> delay(0, max_delay_ms);
+  for (int round = 0; round < rounds; ++round) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      RunChild(dir, round);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay(rng)));
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+  }
+  // 恢复最后一轮遗留的缓存并正常关闭
+  { logger::sink::EffectiveSink sink(MakeConf(dir, rounds)); }
+
+  VerifyResult result = Verify(dir);
+  printf("rounds %d files %zu chunks %zu records %zu duplicates %zu torn tails %zu corrupt chunks %zu gaps %zu\n",
+         rounds, result.files, result.chunks, result.records, result.duplicates, result.torn_tails,
+         result.corrupt_chunks, result.gaps);
+  bool ok = result.corrupt_chunks == 0 && result.gaps == 0;
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  if (ok) {
+    std::filesystem::remove_all(dir);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger/crypt/crypt.h"
+#include "logger/log.h"
+#include "logger/sinks/effective_sink.h"
+#include "logger/variadic_logger.h"
+
+// 各持久化级别的开销: 每kFatalEvery条记录中有一条Fatal记录
+// 输出单次Log的平均/p99/p999耗时、Fatal记录的平均耗时以及包含写文件的总耗时
+// 用法: ./durability_bench [log_dir], 应放在实际部署使用的磁盘上
+
+using Durability = logger::sink::EffectiveSink::Durability;
+
+struct DurabilityCase {
+  const char* name;
+  Durability durability;
+};
+
+constexpr int kRecords = 200000;
+constexpr int kFatalEvery = 10000;
+
+int main(int argc, char** argv) {
+  std::filesystem::path base_dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path().string();
+  std::filesystem::path dir = base_dir / "durability_bench";
+  auto [server_private_key, server_public_key] = logger::crypt::GenECDHKey();
+  std::vector<DurabilityCase> durability_cases = {
+      {"none", Durability::kNone},
+      {"periodic", Durability::kPeriodic},
+      {"file-sync", Durability::kFileSync},
+      {"fatal-sync", Durability::kFatalSync},
+  };
+
+  printf("%-12s %10s %10s %10s %12s %10s\n", "durability", "avg ns", "p99 ns", "p999 ns", "fatal us", "total ms");
+  for (auto& durability_case : durability_cases) {
+    std::filesystem::remove_all(dir);
+    logger::sink::EffectiveSink::Conf conf;
+    conf.dir = dir;
+    conf.prefix = "bench";
+    conf.pub_key = logger::crypt::BinaryKeyToHex(server_public_key);
+    conf.durability = durability_case.durability;
+    conf.sync_interval = std::chrono::milliseconds(100);
+
+    std::vector<double> latencies;
+    latencies.reserve(kRecords);
+    double fatal_ns = 0;
+    double total_ms = 0;
+    {
+      auto sink = std::make_shared<logger::sink::EffectiveSink>(conf);
+      auto log = std::make_shared<logger::VariadicLogger>(sink);
+      auto begin = std::chrono::steady_clock::now();
+      for (int i = 0; i < kRecords; ++i) {
+        auto record_begin = std::chrono::steady_clock::now();
+        if (i % kFatalEvery == kFatalEvery - 1) {
+          LOG_LOGGER_CRITICAL(log, "request {} from user {} failed, status {}", i, "bench_user", "fatal");
+        } else {
+          LOG_LOGGER_INFO(log, "request {} from user {} took {} ms, status {}", i, "bench_user", i % 97, "ok");
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - record_begin).count();
+        if (i % kFatalEvery == kFatalEvery - 1) {
+          fatal_ns += ns;
+        } else {
+          latencies.push_back(ns);
+        }
+      }
+      log->Flush();
+      total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    double sum = 0;
+    for (double ns : latencies) {
+      sum += ns;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    printf("%-12s %10.0f %10.0f %10.0f %12.1f %10.1f\n", durability_case.name, sum / latencies.size(),
+           latencies[latencies.size() * 99 / 100], latencies[latencies.size() * 999 / 1000],
+           fatal_ns / (kRecords / kFatalEvery) / 1000, total_ms);
+  }
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "logger/crypt/crypt.h"
+#include "logger/log.h"
+#include "logger/sinks/effective_sink.h"
+#include "logger/variadic_logger.h"
+
+// 同步写文件(pwritev + fdatasync)与io_uring异步写文件的对比, 异步模式、每段写入文件后都落盘
+// 输出单次Log的平均/p99/p999耗时以及包含写文件的总耗时; 内核不支持io_uring时两者都走同步写
+// 用法: ./io_uring_bench [log_dir], 应放在实际部署使用的磁盘上
+
+using Durability = logger::sink::EffectiveSink::Durability;
+
+struct WriterCase {
+  const char* name;
+  bool io_uring;
+  Durability durability;
+};
+
+constexpr int kRecords = 500000;
+constexpr int kThreads = 4;
+
+int main(int argc, char** argv) {
+  std::filesystem::path base_dir = argc > 1 ? argv[1] : std::filesystem::temp_directory_path().string();
+  std::filesystem::path dir = base_dir / "io_uring_bench";
+  auto [server_private_key, server_public_key] = logger::crypt::GenECDHKey();
+  std::vector<WriterCase> writer_cases = {
+      {"pwritev", false, Durability::kNone},
+      {"io_uring", true, Durability::kNone},
+      {"pwritev+sync", false, Durability::kFileSync},
+      {"io_uring+sync", true, Durability::kFileSync},
+  };
+
+  printf("%-14s %10s %10s %10s %10s\n", "writer", "avg ns", "p99 ns", "p999 ns", "total ms");
+  for (auto& writer_case : writer_cases) {
+    std::filesystem::remove_all(dir);
+    logger::sink::EffectiveSink::Conf conf;
+    conf.dir = dir;
+    conf.prefix = "bench";
+    conf.pub_key = logger::crypt::BinaryKeyToHex(server_public_key);
+    conf.async = true;
+    conf.cache_segments = 8;
+    conf.segment_size = logger::kilobytes(128);
+    conf.durability = writer_case.durability;
+    conf.io_uring = writer_case.io_uring;
+
+    std::vector<std::vector<double>> thread_latencies(kThreads);
+    double total_ms = 0;
+    {
+      auto sink = std::make_shared<logger::sink::EffectiveSink>(conf);
+      auto log = std::make_shared<logger::VariadicLogger>(sink);
+      auto begin = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&, t]() {
+          auto& latencies = thread_latencies[t];
+          latencies.reserve(kRecords / kThreads);
+          for (int i = 0; i < kRecords / kThreads; ++i) {
+            auto record_begin = std::chrono::steady_clock::now();
+            LOG_LOGGER_INFO(log, "request {} from user {} took {} ms, status {}", i, "bench_user", i % 97, "ok");
+            auto record_end = std::chrono::steady_clock::now();
+            latencies.push_back(std::chrono::duration<double, std::nano>(record_end - record_begin).count());
+          }
+        });
+      }
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      log->Flush();
+      total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    }
+    std::vector<double> latencies;
+    for (auto& thread_latency : thread_latencies) {
+      latencies.insert(latencies.end(), thread_latency.begin(), thread_latency.end());
+    }
+    double sum = 0;
+    for (double ns : latencies) {
+      sum += ns;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    printf("%-14s %10.0f %10.0f %10.0f %10.1f\n", writer_case.name, sum / latencies.size(),
+           latencies[latencies.size() * 99 / 100], latencies[latencies.size() * 999 / 1000], total_ms);
+  }
+  std::filesystem::remove_all(dir);
+  return 0;
+}
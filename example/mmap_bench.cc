@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "logger/mmap/mmapper.h"
+
+// MMapper::Push在持续扩容过程中的吞吐: 从4KB开始不断追加直到64MB
+// 输出总吞吐、扩容次数以及单次Push的p99/最大耗时(扩容发生在Push内部)
+
+constexpr size_t kInitialCapacity = 4 * 1024;
+constexpr size_t kTotalSize = 64 * 1024 * 1024;
+constexpr int kRounds = 5;
+
+int main() {
+  std::vector<size_t> record_sizes = {64, 256, 4096};
+  std::filesystem::path file = std::filesystem::temp_directory_path() / "mmap_bench_cache";
+
+  printf("%-8s %12s %10s %12s %12s\n", "record", "MB/s", "grows", "p99 ns", "max us");
+  for (size_t record_size : record_sizes) {
+    std::string record(record_size, 'x');
+    size_t count = kTotalSize / record_size;
+    std::vector<double> latencies;
+    latencies.reserve(count * kRounds);
+    double seconds = 0;
+    size_t grows = 0;
+    for (int round = 0; round < kRounds; ++round) {
+      std::filesystem::remove(file);
+      logger::mmap::MMapper mapper(file, kInitialCapacity);
+      size_t capacity = mapper.Available();
+      auto begin = std::chrono::steady_clock::now();
+      for (size_t i = 0; i < count; ++i) {
+        auto push_begin = std::chrono::steady_clock::now();
+        mapper.Push(record.data(), record.size());
+        auto push_end = std::chrono::steady_clock::now();
+        latencies.push_back(std::chrono::duration<double, std::nano>(push_end - push_begin).count());
+        // 扩容后剩余空间变大
+        size_t available = mapper.Available();
+        if (available + record_size > capacity) {
+          ++grows;
+        }
+        capacity = available;
+      }
+      seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    double mb_per_second = static_cast<double>(kTotalSize) * kRounds / (1024 * 1024) / seconds;
+    printf("%-8zu %12.1f %10zu %12.0f %12.1f\n", record_size, mb_per_second, grows / kRounds,
+           latencies[latencies.size() * 99 / 100], latencies.back() / 1000);
+  }
+  std::filesystem::remove(file);
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "logger/crypt/crypt.h"
+#include "logger/log.h"
+#include "logger/sinks/effective_sink.h"
+#include "logger/variadic_logger.h"
+
+// EffectiveSink各流水线阶段组合的对比: 压缩方式(含级别) x 加密方式
+// 输出每条记录在调用线程上的耗时、包含写文件的总耗时以及最终的文件大小
+
+using logger::compress::CompressType;
+using logger::crypt::CipherType;
+
+struct CompressCase {
+  const char* name;
+  CompressType type;
+  int level;
+};
+
+struct CipherCase {
+  const char* name;
+  CipherType type;
+};
+
+constexpr int kRecords = 200000;
+
+static size_t DirSize(const std::filesystem::path& dir) {
+  size_t size = 0;
+  for (auto& entry : std::filesystem::directory_iterator(dir)) {
+    if (entry.path().extension() == ".log") {
+      size += entry.file_size();
+    }
+  }
+  return size;
+}
+
+int main() {
+  auto [server_private_key, server_public_key] = logger::crypt::GenECDHKey();
+  std::vector<CompressCase> compress_cases = {
+      {"none", CompressType::kNone, 0},  {"zlib-1", CompressType::kZlib, 1}, {"zlib-6", CompressType::kZlib, 6},
+      {"zstd-1", CompressType::kZstd, 1}, {"zstd-5", CompressType::kZstd, 5}, {"zstd-9", CompressType::kZstd, 9},
+  };
+  std::vector<CipherCase> cipher_cases = {
+      {"none", CipherType::kNone}, {"aes-cbc", CipherType::kAesCbc},
+      {"aes-ctr", CipherType::kAesCtr}, {"aes-gcm", CipherType::kAesGcm},
+  };
+
+  printf("%-8s %-8s %12s %12s %12s\n", "compress", "cipher", "ns/record", "total ms", "file KB");
+  for (auto& compress_case : compress_cases) {
+    for (auto& cipher_case : cipher_cases) {
+      std::filesystem::path dir = std::filesystem::temp_directory_path() / "pipeline_bench";
+      std::filesystem::remove_all(dir);
+
+      logger::sink::EffectiveSink::Conf conf;
+      conf.dir = dir;
+      conf.prefix = "bench";
+      conf.pub_key = logger::crypt::BinaryKeyToHex(server_public_key);
+      conf.compress = compress_case.type;
+      conf.compress_level = compress_case.level;
+      conf.cipher = cipher_case.type;
+
+      double ns_per_record = 0;
+      double total_ms = 0;
+      {
+        auto sink = std::make_shared<logger::sink::EffectiveSink>(conf);
+        auto log = std::make_shared<logger::VariadicLogger>(sink);
+        auto begin = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRecords; ++i) {
+          LOG_LOGGER_INFO(log, "request {} from user {} took {} ms, status {}", i, "bench_user", i % 97, "ok");
+        }
+        auto logged = std::chrono::steady_clock::now();
+        log->Flush();
+        auto end = std::chrono::steady_clock::now();
+        ns_per_record = std::chrono::duration<double, std::nano>(logged - begin).count() / kRecords;
+        total_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+      }
+      printf("%-8s %-8s %12.1f %12.1f %12zu\n", compress_case.name, cipher_case.name, ns_per_record, total_ms,
+             DirSize(dir) / 1024);
+      std::filesystem::remove_all(dir);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <iostream>
+
+#include "logger/log_common.h"
+
+// 对比SourceLocation的构造开销:
+// 1. 旧实现: 每次调用在运行期rfind('/')与rfind('\\')截取文件名
+// 2. constexpr构造函数, 但实参在运行期才确定(非宏调用方)
+// 3. 宏中的static constexpr常量: 编译期生成, 调用处没有任何字符串扫描
+
+struct LegacySourceLocation {
+  LegacySourceLocation(logger::StringView file_name_in, int32_t line_in, logger::StringView func_name_in)
+      : file_name{file_name_in}, line{line_in}, func_name{func_name_in} {
+    if (!file_name.empty()) {
+      size_t pos = file_name.rfind('/');
+      if (pos != logger::StringView::npos) {
+        file_name = file_name.substr(pos + 1);
+      } else {
+        pos = file_name.rfind('\\');
+        if (pos != logger::StringView::npos) {
+          file_name = file_name.substr(pos + 1);
+        }
+      }
+    }
+  }
+
+  logger::StringView file_name;
+  int32_t line{0};
+  logger::StringView func_name;
+};
+
+// 防止编译器把循环优化掉
+static volatile size_t g_sink = 0;
+static const char* volatile g_file = __FILE__;
+
+constexpr int kIterations = 50000000;
+
+template <typename Func>
+double Measure(const char* name, Func&& func) {
+  auto begin = std::chrono::steady_clock::now();
+  for (int i = 0; i < kIterations; ++i) {
+    func();
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(end - begin).count() / kIterations;
+  std::cout << name << ": " << ns << " ns/call" << std::endl;
+  return ns;
+}
+
+int main() {
+  double legacy = Measure("legacy runtime constructor", []() {
+    LegacySourceLocation loc{g_file, __LINE__, static_cast<const char*>(__FUNCTION__)};
+    g_sink = g_sink + loc.file_name.size();
+  });
+
+  Measure("constexpr constructor, runtime arguments", []() {
+    logger::SourceLocation loc{g_file, __LINE__, static_cast<const char*>(__FUNCTION__)};
+    g_sink = g_sink + loc.file_name.size();
+  });
+
+  double constant = Measure("static constexpr location (LOGGER_CALL)", []() {
+    static constexpr logger::SourceLocation loc{__FILE__, __LINE__, static_cast<const char*>(__FUNCTION__)};
+    g_sink = g_sink + loc.file_name.size();
+  });
+
+  std::cout << "saving per call: " << legacy - constant << " ns" << std::endl;
+  return 0;
+}
@@ -0,0 +1,23 @@
+#include "compress/compress.h"
+
+#include "compress/none_compress.h"
+#include "compress/zlib_compress.h"
+#include "compress/zstd_compress.h"
+
+namespace logger {
+namespace compress {
+
+std::unique_ptr<Compression> CreateCompression(CompressType type, int level) {
+  switch (type) {
+    case CompressType::kZlib:
+      return std::make_unique<ZlibCompression>(level);
+    case CompressType::kNone:
+      return std::make_unique<NoneCompression>();
+    case CompressType::kZstd:
+    default:
+      return std::make_unique<ZstdCompression>(level);
+  }
+}
+
+}  // namespace compress
+}  // namespace logger
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 namespace logger {
 namespace compress {
+// 记录在ChunkHeader中的压缩方式
+enum class CompressType : uint8_t {
+  kZstd = 0,
+  kZlib = 1,
+  kNone = 2,  // 不压缩, 原样拷贝
+};
+
 // 压缩类的父类,提供统一的接口
 class Compression {
  public:
@@ -18,6 +26,19 @@ class Compression {
   virtual std::string Uncompress(const void* data, size_t size) = 0;
 
   virtual void ResetStream() = 0;
+  // 加载压缩字典, 压缩与解压两端必须使用同一个字典, 不支持字典的算法返回false
+  virtual bool SetDictionary(const std::string& dict) { return false; }
+  // 当前字典的id, 未使用字典为0
+  virtual uint32_t DictID() const { return 0; }
+  // 调整压缩级别, 从下一帧开始生效, 不支持运行时调整的算法返回false
+  virtual bool SetLevel(int level) { return false; }
+  // 当前正在使用的压缩级别
+  virtual int Level() const { return 0; }
+  // 开启长距离匹配, 窗口为2^window_log字节, 从下一帧开始生效, 不支持的算法返回false
+  virtual bool EnableLongDistance(int window_log) { return false; }
 };
+
+// 按类型创建压缩对象, level为各算法自己的压缩级别
+std::unique_ptr<Compression> CreateCompression(CompressType type, int level);
 }  // namespace compress
 }  // namespace logger
@@ -0,0 +1,28 @@
+#include "compress/none_compress.h"
+
+#include <cstring>
+
+namespace logger {
+namespace compress {
+
+size_t NoneCompression::Compress(const void* input, size_t input_size, void* output, size_t output_size) {
+  if (!input || input_size == 0 || output_size < input_size) {
+    return 0;
+  }
+  memcpy(output, input, input_size);
+  return input_size;
+}
+
+size_t NoneCompression::CompressedBound(size_t input_size) {
+  return input_size;
+}
+
+std::string NoneCompression::Uncompress(const void* data, size_t size) {
+  if (!data) {
+    return "";
+  }
+  return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+}  // namespace compress
+}  // namespace logger
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "compress/compress.h"
+
+namespace logger {
+namespace compress {
+
+// 不压缩, 用于更看重速度的场景
+class NoneCompression final : public Compression {
+ public:
+  ~NoneCompression() override = default;
+
+  size_t Compress(const void* input, size_t input_size, void* output, size_t output_size) override;
+
+  size_t CompressedBound(size_t input_size) override;
+
+  std::string Uncompress(const void* data, size_t size) override;
+
+  void ResetStream() override {}
+};
+
+}  // namespace compress
+}  // namespace logger
@@ -89,7 +89,7 @@ void ZlibCompression::ResetStream() {
   compress_stream_->zfree = Z_NULL;
   compress_stream_->opaque = Z_NULL;
   // 调用 deflateInit2 初始化压缩流
-  int32_t ret = deflateInit2(compress_stream_.get(), Z_BEST_COMPRESSION, Z_DEFLATED, MAX_WBITS, MAX_MEM_LEVEL,
+  int32_t ret = deflateInit2(compress_stream_.get(), level_, Z_DEFLATED, MAX_WBITS, MAX_MEM_LEVEL,
                              Z_DEFAULT_STRATEGY);
   if (ret != Z_OK) {
     compress_stream_.reset();  // 初始化失败，释放压缩流
@@ -112,10 +112,12 @@ void ZlibCompression::ResetUncompressStream_() {
 }
 
 size_t ZlibCompression::CompressedBound(size_t input_size) {
-  // 使用 zlib 的 deflateBound 函数计算压缩数据的最大可能大小
-  //   printf("%d\n",input_size + 10);
-  //   return deflateBound(compress_stream_.get(), input_size);
-  return input_size + 10;
+  // 使用 zlib 的 deflateBound 函数计算压缩数据的最大可能大小, 另加Z_SYNC_FLUSH的空块
+  // 输出空间不足时Compress会一直返回Z_BUF_ERROR, 不能只按input_size估算
+  if (compress_stream_) {
+    return deflateBound(compress_stream_.get(), input_size) + 6;
+  }
+  return compressBound(input_size) + 6;
 }
 
 }  // namespace compress
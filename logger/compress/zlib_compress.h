@@ -26,6 +26,8 @@ struct ZStreamInflateDeleter {
 
 class ZlibCompression final : public Compression {
  public:
+  // level: zlib压缩级别 1~9
+  explicit ZlibCompression(int level = Z_BEST_COMPRESSION) : level_(level) {}
   ~ZlibCompression() override = default;
   size_t Compress(const void* input, size_t input_size, void* output, size_t output_size) override;
 
@@ -38,6 +40,7 @@ class ZlibCompression final : public Compression {
  private:
   void ResetUncompressStream_();
 
+  int level_;
   std::unique_ptr<z_stream, ZStreamDeflateDeleter> compress_stream_;    // 压缩流
   std::unique_ptr<z_stream, ZStreamInflateDeleter> uncompress_stream_;  // 解压流
 };
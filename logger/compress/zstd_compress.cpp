@@ -1,15 +1,17 @@
+#include <algorithm>
 #include <cstring>
 
 #include "compress/zstd_compress.h"
+#include "helpers/internal_log.h"
 
 namespace logger {
 namespace compress {
 
-ZstdCompression::ZstdCompression() {
+ZstdCompression::ZstdCompression(int level) : level_(level), pending_level_(level) {
   // 创建压缩上下文
   cctx_ = ZSTD_createCCtx();
-  // 设置压缩级别为 5
-  ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, 5);
+  // 设置压缩级别
+  ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level);
 
   // 创建解压缩上下文
   dctx_ = ZSTD_createDCtx();
@@ -25,6 +27,31 @@ ZstdCompression::~ZstdCompression() {
   if (dctx_) {
     ZSTD_freeDCtx(dctx_);
   }
+  // 释放字典
+  if (ddict_) {
+    ZSTD_freeDDict(ddict_);
+  }
+}
+
+bool ZstdCompression::SetDictionary(const std::string& dict) {
+  uint32_t dict_id = ZSTD_getDictID_fromDict(dict.data(), dict.size());
+  if (dict_id == 0) {
+    LOG_ERROR("ZstdCompression::SetDictionary: invalid zstd dictionary");
+    return false;
+  }
+  ZSTD_DDict* ddict = ZSTD_createDDict(dict.data(), dict.size());
+  // 压缩端由cctx内部按当前级别生成并缓存CDict, 引用外部CDict会固定为其创建时的级别
+  if (!ddict || ZSTD_isError(ZSTD_CCtx_loadDictionary(cctx_, dict.data(), dict.size()))) {
+    ZSTD_freeDDict(ddict);
+    LOG_ERROR("ZstdCompression::SetDictionary: load dictionary failed");
+    return false;
+  }
+  // 字典对之后的所有帧生效, reset_session_only不会清除
+  ZSTD_DCtx_refDDict(dctx_, ddict);
+  ZSTD_freeDDict(ddict_);
+  ddict_ = ddict;
+  dict_id_ = dict_id;
+  return true;
 }
 
 size_t ZstdCompression::Compress(const void* input, size_t input_size, void* output, size_t output_size) {
@@ -36,13 +63,19 @@ size_t ZstdCompression::Compress(const void* input, size_t input_size, void* out
   ZSTD_inBuffer input_buffer = {input, input_size, 0};
   ZSTD_outBuffer output_buffer = {const_cast<void*>(reinterpret_cast<const void*>(output)), output_size, 0};
 
+  // 压缩级别只能在帧开始前修改: 有待应用的级别时本次结束当前帧, 下一次压缩以新级别开始新帧
+  bool end_frame = pending_level_ != level_;
   // 调用 ZSTD_compressStream2 进行压缩
-  size_t ret = ZSTD_compressStream2(cctx_, &output_buffer, &input_buffer, ZSTD_e_flush);
+  size_t ret =
+      ZSTD_compressStream2(cctx_, &output_buffer, &input_buffer, end_frame ? ZSTD_e_end : ZSTD_e_flush);
 
   // 检查是否发生错误
   if (ZSTD_isError(ret) != 0) {
     return 0;
   }
+  if (end_frame && ret == 0) {
+    ApplyLevel_();
+  }
 
   // 返回压缩后的数据大小
   return output_buffer.pos;
@@ -85,29 +118,34 @@ std::string ZstdCompression::Uncompress(const void* data, size_t size) {
 
   // 检查数据是否为 ZSTD 压缩格式
   if (IsZSTDCompressed(data, size)) {
-    // 重置解压缩流
-    ResetStream();
+    // 新的压缩帧开始, 重置解压缩流
+    ResetUncompressStream_();
   }
 
   // 初始化输出字符串
   std::string output;
-  output.reserve(10 * 1024);  // 预分配 10KB 的空间
+  size_t out_chunk_size = ZSTD_DStreamOutSize();
 
-  // 初始化输入和输出缓冲区
+  // 初始化输入缓冲区
   ZSTD_inBuffer input = {data, size, 0};
-  ZSTD_outBuffer output_buffer = {const_cast<void*>(reinterpret_cast<const void*>(output.data())), output.capacity(),
-                                  0};
-
-  // 调用 ZSTD_decompressStream 进行解压缩
-  size_t ret = ZSTD_decompressStream(dctx_, &output_buffer, &input);
-
-  // 检查是否发生错误
-  if (ZSTD_isError(ret) != 0) {
-    return "";
-  }
+  ZSTD_outBuffer output_buffer = {nullptr, 0, 0};
+  // 输出缓冲区被写满时可能还有未输出的数据, 继续解压直到输入耗尽且输出未满
+  do {
+    size_t old_size = output.size();
+    output.resize(old_size + out_chunk_size);
+    output_buffer = {output.data() + old_size, out_chunk_size, 0};
+
+    // 调用 ZSTD_decompressStream 进行解压缩
+    size_t ret = ZSTD_decompressStream(dctx_, &output_buffer, &input);
+
+    // 检查是否发生错误
+    if (ZSTD_isError(ret) != 0) {
+      return "";
+    }
+    output.resize(old_size + output_buffer.pos);
+  } while (input.pos < input.size || output_buffer.pos == output_buffer.size);
 
   // 返回解压缩后的数据
-  output = std::string(reinterpret_cast<char*>(output_buffer.dst), output_buffer.pos);
   return output;
 }
 
@@ -116,9 +154,31 @@ void ZstdCompression::ResetStream() {
   // 重置压缩上下文
   if (cctx_) {
     ZSTD_CCtx_reset(cctx_, ZSTD_reset_session_only);
+    ApplyLevel_();
   }
 }
 
+bool ZstdCompression::SetLevel(int level) {
+  level = std::max(ZSTD_minCLevel(), std::min(level, ZSTD_maxCLevel()));
+  pending_level_ = level;
+  return true;
+}
+
+void ZstdCompression::ApplyLevel_() {
+  if (pending_level_ == level_) {
+    return;
+  }
+  if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, pending_level_)) == 0) {
+    level_ = pending_level_;
+  }
+}
+
+bool ZstdCompression::EnableLongDistance(int window_log) {
+  // 解压端默认只接受不超过2^27的窗口, 更大的窗口需要解压端设置ZSTD_d_windowLogMax
+  return ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_enableLongDistanceMatching, 1)) == 0 &&
+         ZSTD_isError(ZSTD_CCtx_setParameter(cctx_, ZSTD_c_windowLog, window_log)) == 0;
+}
+
 // 计算压缩数据的最大可能大小
 size_t ZstdCompression::CompressedBound(size_t input_size) {
   // 调用 ZSTD_compressBound 计算压缩数据的最大可能大小
@@ -8,7 +8,8 @@ namespace compress {
 
 class ZstdCompression final : public Compression {
  public:
-  ZstdCompression();
+  // level: zstd压缩级别, 负数为快速模式
+  explicit ZstdCompression(int level = 5);
   ~ZstdCompression() override;
 
   size_t Compress(const void* input, size_t input_size, void* output, size_t output_size) override;
@@ -19,12 +20,29 @@ class ZstdCompression final : public Compression {
 
   size_t CompressedBound(size_t input_size) override;
 
+  bool SetDictionary(const std::string& dict) override;
+
+  uint32_t DictID() const override { return dict_id_; }
+
+  bool SetLevel(int level) override;
+
+  int Level() const override { return level_; }
+
+  bool EnableLongDistance(int window_log) override;
+
  private:
   void ResetUncompressStream_();
 
+  void ApplyLevel_();
+
  private:
+  int level_;
+  int pending_level_;  // SetLevel设置的级别, 在帧边界应用
   ZSTD_CCtx* cctx_;
   ZSTD_DCtx* dctx_;
+  // 预处理过的解压字典, 每个新帧引用即可, 不必重新加载
+  ZSTD_DDict* ddict_{nullptr};
+  uint32_t dict_id_{0};
 };
 }  // namespace compress
 }  // namespace logger
@@ -43,4 +43,7 @@ class Context {
 #define POST_REPEATED_TASK(runner_tag, task, delay_time, repeat_num) \
   EXECUTOR->PostRepeatedTask(runner_tag, task, delay_time, repeat_num)
 
+#define CANCEL_REPEATED_TASK(task_id) EXECUTOR->CancelRepeatedTask(task_id)
+
+#define PENDING_TASK_COUNT(runner_tag) EXECUTOR->PendingTaskCount(runner_tag)
 #define WAIT_TASK_IDLE(runner_tag) EXECUTOR->PostTaskAndGetResult(runner_tag, []() {})->wait()
\ No newline at end of file
@@ -66,12 +66,16 @@ RepeatedTaskId Executor::ExecutorTimer::PostRepeatedTask(Task task,
                                                          RepeatedTaskNum repeated_num) {
   // 获取repeated_task_id
   RepeatedTaskId repeated_task_id = GetNextPepeatedTaskId();
-  repeated_id_state_set_.insert(repeated_task_id);
+  {
+    std::lock_guard<std::mutex> lock(repeated_mtx_);
+    repeated_id_state_set_.insert(repeated_task_id);
+  }
   PostRepeatedTask_(std::move(task), delay_time, repeated_task_id, repeated_num);
   return repeated_task_id;
 }
 
 void Executor::ExecutorTimer::CancelRepeatedTask(RepeatedTaskId repeated_task_id) {
+  std::lock_guard<std::mutex> lock(repeated_mtx_);
   repeated_id_state_set_.erase(repeated_task_id);
 }
 
@@ -88,11 +92,15 @@ void Executor::ExecutorTimer::PostRepeatedTask_(Task task,
                                                 const std::chrono::microseconds& delay_time,
                                                 RepeatedTaskId repeated_task_id,
                                                 RepeatedTaskNum repeated_task_num) {
-  if (repeated_id_state_set_.find(repeated_task_id) == repeated_id_state_set_.end() || repeated_task_num == 0) {
-    return;
+  {
+    // 持锁检查并执行, 保证CancelRepeatedTask返回后任务不会再执行
+    std::lock_guard<std::mutex> lock(repeated_mtx_);
+    if (repeated_id_state_set_.find(repeated_task_id) == repeated_id_state_set_.end() || repeated_task_num == 0) {
+      return;
+    }
+    // 执行重复任务
+    task();
   }
-  // 执行重复任务
-  task();
   Task func = std::bind(&Executor::ExecutorTimer::PostTask_, this, std::move(task), delay_time, repeated_task_id,
                         repeated_task_num - 1);
 
@@ -152,5 +160,10 @@ void Executor::PostTask(const TaskRunnerTag& runner_tag, Task task) {
   task_runner->RunTask(std::move(task));
 }
 
+size_t Executor::PendingTaskCount(const TaskRunnerTag& runner_tag) {
+  ExecutorContext::TaskRunner* task_runner = executor_context_->GetTaskRunner(runner_tag);
+  return task_runner ? task_runner->PendingTaskCount() : 0;
+}
+
 }  // namespace context
 }  // namespace logger
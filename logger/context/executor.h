@@ -60,6 +60,7 @@ class Executor {
                                     const std::chrono::microseconds& delay_time,
                                     RepeatedTaskNum repeated_num);
 
+    // 返回后该重复任务不会再被投递
     void CancelRepeatedTask(RepeatedTaskId repeated_task_id);
 
    private:
@@ -84,6 +85,7 @@ class Executor {
     std::unique_ptr<ThreadPool> thread_pool_;
 
     std::atomic<RepeatedTaskId> repeated_task_id_;
+    std::mutex repeated_mtx_;  // 保护repeated_id_state_set_, 检查与投递重复任务期间持有
     std::unordered_set<RepeatedTaskId> repeated_id_state_set_;  // 存放RepeatedTaskId的字典
   };
 
@@ -122,6 +124,9 @@ class Executor {
 
   void PostTask(const TaskRunnerTag& runner_tag, Task task);
 
+  // task runner中排队等待执行的任务数
+  size_t PendingTaskCount(const TaskRunnerTag& runner_tag);
+
   template <typename R, typename P>
   void PostDelayedTask(const TaskRunnerTag& runner_tag, Task task, const std::chrono::duration<R, P>& delta) {
     // 将对应线程池执行task任务 封装为一个func
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace logger {
+namespace context {
+
+// 单生产者单消费者(SPSC)无锁字节环形缓冲区
+// 生产者: TryReserve -> Write... -> Commit
+// 消费者: Readable -> Read... -> Release
+class SpscRingBuffer {
+ public:
+  // 容量向上取整为2的幂
+  explicit SpscRingBuffer(size_t capacity) : capacity_(RoundUpPowerOfTwo_(capacity)), mask_(capacity_ - 1) {
+    buffer_ = std::make_unique<uint8_t[]>(capacity_);
+  }
+
+  SpscRingBuffer(const SpscRingBuffer&) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+  size_t Capacity() const noexcept { return capacity_; }
+
+  // 生产者: 预留size字节的写入空间, 空间不足返回false
+  bool TryReserve(size_t size) {
+    if (capacity_ - (write_pos_ - cached_head_) >= size) {
+      return true;
+    }
+    // 缓存的消费位置不够用时才读取共享的head_
+    cached_head_ = head_.load(std::memory_order_acquire);
+    return capacity_ - (write_pos_ - cached_head_) >= size;
+  }
+
+  // 生产者: 向预留空间追加数据(处理回绕)
+  void Write(const void* data, size_t size) {
+    size_t offset = write_pos_ & mask_;
+    size_t first = std::min(size, capacity_ - offset);
+    memcpy(buffer_.get() + offset, data, first);
+    memcpy(buffer_.get(), static_cast<const uint8_t*>(data) + first, size - first);
+    write_pos_ += size;
+  }
+
+  // 生产者: 发布已写入的数据
+  void Commit() { tail_.store(write_pos_, std::memory_order_release); }
+
+  // 消费者: 可读字节数
+  size_t Readable() const { return tail_.load(std::memory_order_acquire) - read_pos_; }
+
+  // 消费者: 读取size字节到dst(处理回绕)
+  void Read(void* dst, size_t size) {
+    size_t offset = read_pos_ & mask_;
+    size_t first = std::min(size, capacity_ - offset);
+    memcpy(dst, buffer_.get() + offset, first);
+    memcpy(static_cast<uint8_t*>(dst) + first, buffer_.get(), size - first);
+    read_pos_ += size;
+  }
+
+  // 消费者: 归还已读取的空间给生产者
+  void Release() { head_.store(read_pos_, std::memory_order_release); }
+
+  // 任意线程: 尚未被消费的字节数
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+ private:
+  static size_t RoundUpPowerOfTwo_(size_t value) {
+    size_t result = 64;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<uint8_t[]> buffer_;
+
+  // 生产者与消费者各自独占的缓存行, 避免伪共享
+  alignas(64) std::atomic<size_t> tail_{0};  // 生产者已发布位置
+  size_t write_pos_{0};                      // 生产者私有写位置
+  size_t cached_head_{0};                    // 生产者缓存的消费位置
+
+  alignas(64) std::atomic<size_t> head_{0};  // 消费者已归还位置
+  size_t read_pos_{0};                       // 消费者私有读位置
+};
+
+}  // namespace context
+}  // namespace logger
@@ -57,6 +57,9 @@ class ThreadPool {
     return std::make_shared<std::future<return_type>>(std::move(res));
   }
 
+  // 排队中尚未开始执行的任务数
+  size_t PendingTaskCount() const { return task_queue_.size(); }
+
  private:
   void AddThread();
 
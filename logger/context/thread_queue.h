@@ -75,6 +75,11 @@ class ThreadQueue {
     std::lock_guard<std::mutex> lock(mtx_);
     return data_queue_.empty();
   }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mtx_);
+    return data_queue_.size();
+  }
   void StopWait() {
     if (stop_wait_.load()) {
       return;
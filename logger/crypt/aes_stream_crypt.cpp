@@ -0,0 +1,121 @@
+#include "crypt/aes_stream_crypt.h"
+
+#include "helpers/internal_log.h"
+
+namespace logger {
+namespace crypt {
+
+// GCM使用iv的前12字节
+static constexpr int kGcmIVSize = 12;
+
+AESStreamCrypt::AESStreamCrypt(std::string key, CipherType type)
+    : key_(std::move(key)), type_(type), ctx_(EVP_CIPHER_CTX_new()) {
+  if (!ctx_) {
+    LOG_ERROR("Failed to create EVP cipher context");
+  }
+  if (type_ != CipherType::kAesCtr && type_ != CipherType::kAesGcm) {
+    LOG_ERROR("AESStreamCrypt only supports CTR and GCM");
+  }
+}
+
+AESStreamCrypt::~AESStreamCrypt() {
+  EVP_CIPHER_CTX_free(ctx_);
+}
+
+const EVP_CIPHER* AESStreamCrypt::Cipher_() const {
+  bool gcm = type_ == CipherType::kAesGcm;
+  // 根据密钥长度选择 AES 模式
+  if (key_.size() == 16) {
+    return gcm ? EVP_aes_128_gcm() : EVP_aes_128_ctr();
+  } else if (key_.size() == 24) {
+    return gcm ? EVP_aes_192_gcm() : EVP_aes_192_ctr();
+  } else if (key_.size() == 32) {
+    return gcm ? EVP_aes_256_gcm() : EVP_aes_256_ctr();
+  }
+  return nullptr;
+}
+
+bool AESStreamCrypt::Init_(const std::string& iv, bool encrypt) {
+  const EVP_CIPHER* cipher = Cipher_();
+  if (!ctx_ || !cipher) {
+    LOG_ERROR("Invalid AES key size");
+    return false;
+  }
+  if (iv.size() < 16) {
+    LOG_ERROR("Invalid AES IV size");
+    return false;
+  }
+  // 先设置算法, GCM需要在设置key和iv前指定iv长度
+  if (!EVP_CipherInit_ex(ctx_, cipher, nullptr, nullptr, nullptr, encrypt ? 1 : 0)) {
+    LOG_ERROR("Failed to initialize cipher");
+    return false;
+  }
+  if (type_ == CipherType::kAesGcm && !EVP_CIPHER_CTX_ctrl(ctx_, EVP_CTRL_GCM_SET_IVLEN, kGcmIVSize, nullptr)) {
+    LOG_ERROR("Failed to set GCM IV length");
+    return false;
+  }
+  if (!EVP_CipherInit_ex(ctx_, nullptr, nullptr, reinterpret_cast<const unsigned char*>(key_.data()),
+                         reinterpret_cast<const unsigned char*>(iv.data()), encrypt ? 1 : 0)) {
+    LOG_ERROR("Failed to set cipher key and IV");
+    return false;
+  }
+  return true;
+}
+
+bool AESStreamCrypt::EncryptInit(const std::string& iv) {
+  return Init_(iv, true);
+}
+
+bool AESStreamCrypt::Encrypt(void* data, size_t size) {
+  // 流模式下输出长度与输入相同, 可以原地处理
+  int output_len = 0;
+  auto buf = reinterpret_cast<unsigned char*>(data);
+  if (!EVP_EncryptUpdate(ctx_, buf, &output_len, buf, static_cast<int>(size))) {
+    LOG_ERROR("Failed to encrypt data");
+    return false;
+  }
+  return true;
+}
+
+bool AESStreamCrypt::EncryptFinal(char* tag) {
+  unsigned char final_buf[EVP_MAX_BLOCK_LENGTH];
+  int final_len = 0;
+  if (!EVP_EncryptFinal_ex(ctx_, final_buf, &final_len)) {
+    LOG_ERROR("Failed to finalize encryption");
+    return false;
+  }
+  if (type_ == CipherType::kAesGcm && !EVP_CIPHER_CTX_ctrl(ctx_, EVP_CTRL_GCM_GET_TAG, kTagSize, tag)) {
+    LOG_ERROR("Failed to get GCM tag");
+    return false;
+  }
+  return true;
+}
+
+bool AESStreamCrypt::DecryptInit(const std::string& iv) {
+  return Init_(iv, false);
+}
+
+bool AESStreamCrypt::Decrypt(void* data, size_t size) {
+  int output_len = 0;
+  auto buf = reinterpret_cast<unsigned char*>(data);
+  if (!EVP_DecryptUpdate(ctx_, buf, &output_len, buf, static_cast<int>(size))) {
+    LOG_ERROR("Failed to decrypt data");
+    return false;
+  }
+  return true;
+}
+
+bool AESStreamCrypt::DecryptFinal(const char* tag) {
+  if (type_ == CipherType::kAesGcm &&
+      !EVP_CIPHER_CTX_ctrl(ctx_, EVP_CTRL_GCM_SET_TAG, kTagSize, const_cast<char*>(tag))) {
+    LOG_ERROR("Failed to set GCM tag");
+    return false;
+  }
+  unsigned char final_buf[EVP_MAX_BLOCK_LENGTH];
+  int final_len = 0;
+  // GCM在此校验tag
+  return EVP_DecryptFinal_ex(ctx_, final_buf, &final_len) == 1;
+}
+
+}  // namespace crypt
+}  // namespace logger
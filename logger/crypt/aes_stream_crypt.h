@@ -0,0 +1,51 @@
+#pragma once
+
+#include <openssl/evp.h>
+
+#include <string>
+
+#include "crypt/crypt.h"
+
+namespace logger {
+namespace crypt {
+
+// chunk级流式AES加密(CTR/GCM), 复用同一个EVP上下文
+// 每个chunk开始时用ChunkHeader::iv初始化一次, 之后按顺序原地加解密每个item, 无填充也无额外分配
+class AESStreamCrypt final {
+ public:
+  static constexpr size_t kTagSize = 16;
+
+  AESStreamCrypt(std::string key, CipherType type);
+  ~AESStreamCrypt();
+
+  AESStreamCrypt(const AESStreamCrypt&) = delete;
+  AESStreamCrypt& operator=(const AESStreamCrypt&) = delete;
+
+  CipherType Type() const { return type_; }
+
+  // 开始一个chunk的加密
+  bool EncryptInit(const std::string& iv);
+  // 原地加密
+  bool Encrypt(void* data, size_t size);
+  // 结束chunk的加密, GCM模式输出kTagSize字节的tag
+  bool EncryptFinal(char* tag);
+
+  // 开始一个chunk的解密
+  bool DecryptInit(const std::string& iv);
+  // 原地解密
+  bool Decrypt(void* data, size_t size);
+  // 结束chunk的解密, GCM模式校验tag, 不一致返回false
+  bool DecryptFinal(const char* tag);
+
+ private:
+  const EVP_CIPHER* Cipher_() const;
+
+  bool Init_(const std::string& iv, bool encrypt);
+
+  std::string key_;
+  CipherType type_;
+  EVP_CIPHER_CTX* ctx_;
+};
+
+}  // namespace crypt
+}  // namespace logger
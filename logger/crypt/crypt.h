@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <tuple>
@@ -7,6 +8,14 @@
 namespace logger {
 namespace crypt {
 
+// 记录在ChunkHeader中的加密方式
+enum class CipherType : uint8_t {
+  kAesCbc = 0,  // 逐条CBC加密, 带填充
+  kAesCtr = 1,  // chunk级流式CTR加密
+  kAesGcm = 2,  // chunk级流式GCM加密, chunk结束时生成校验tag
+  kNone = 3,    // 不加密, 用于仅内网使用的场景
+};
+
 // 生成ECDH密钥对的函数，返回一个包含私钥和公钥的元组
 std::tuple<std::string, std::string> GenECDHKey();
 
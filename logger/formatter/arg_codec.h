@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include "fmt/core.h"
+#include "log_common.h"
+
+namespace logger {
+namespace formatter {
+
+/**
+ * @brief 延迟格式化的参数编解码
+ *
+ * 调用处把参数包编码为紧凑的二进制: 算术类型、枚举和void指针直接memcpy, 字符串编码为[uint32长度][内容]。
+ * 后台线程通过FormatDeferred<Args...>按编译期已知的类型依次解码, 再交给fmt格式化。
+ * 其余类型(自定义类型、可能引用调用方内存的视图等)无法延迟, 仍在调用处格式化。
+ * 非字面量的格式串以字符串形式编码在参数之前, 此时传给FormatDeferred的fmt为空(data()为nullptr)。
+ */
+
+template <typename T>
+using RemoveCVRef = std::remove_cv_t<std::remove_reference_t<T>>;
+
+// 字符串类参数: 内容被拷贝, 解码为StringView
+template <typename T>
+constexpr bool kIsStringArg =
+    std::is_same_v<T, std::string> || std::is_same_v<T, std::string_view> || std::is_same_v<T, fmt::string_view> ||
+    std::is_same_v<T, const char*> || std::is_same_v<T, char*> ||
+    (std::is_array_v<T> && std::is_same_v<std::remove_cv_t<std::remove_extent_t<T>>, char>);
+
+// 按字节拷贝的参数: 只限不引用其他内存的类型, 后台格式化时调用方的数据可能已经释放
+template <typename T>
+constexpr bool kIsTrivialArg = std::is_arithmetic_v<T> || std::is_enum_v<T> ||
+                               (std::is_pointer_v<T> && std::is_void_v<std::remove_pointer_t<T>>);
+
+// 参数包中所有参数都可编码时才能延迟格式化
+template <typename... Args>
+constexpr bool kIsDeferrable = ((kIsStringArg<RemoveCVRef<Args>> || kIsTrivialArg<RemoveCVRef<Args>>) && ...);
+
+inline StringView ToStringView(const char* str) {
+  return str ? StringView(str) : StringView();
+}
+inline StringView ToStringView(const std::string& str) {
+  return StringView(str);
+}
+inline StringView ToStringView(std::string_view str) {
+  return str;
+}
+inline StringView ToStringView(fmt::string_view str) {
+  return StringView(str.data(), str.size());
+}
+
+template <typename T>
+void EncodeArg(const T& value, std::string& dest) {
+  using Type = RemoveCVRef<T>;
+  if constexpr (kIsStringArg<Type>) {
+    StringView str = ToStringView(value);
+    uint32_t len = static_cast<uint32_t>(str.size());
+    dest.append(reinterpret_cast<const char*>(&len), sizeof(len));
+    dest.append(str.data(), str.size());
+  } else {
+    dest.append(reinterpret_cast<const char*>(&value), sizeof(Type));
+  }
+}
+
+// 编码整个参数包, 结果追加到dest
+template <typename... Args>
+void EncodeArgs(std::string& dest, const Args&... args) {
+  (EncodeArg(args, dest), ...);
+}
+
+template <typename T>
+auto DecodeArg(const char*& data) {
+  if constexpr (kIsStringArg<T>) {
+    uint32_t len = 0;
+    memcpy(&len, data, sizeof(len));
+    StringView str(data + sizeof(len), len);
+    data += sizeof(len) + len;
+    return str;
+  } else {
+    T value;
+    memcpy(&value, data, sizeof(T));
+    data += sizeof(T);
+    return value;
+  }
+}
+
+template <typename... Ts>
+struct TypeList {};
+
+template <typename... Decoded>
+void FormatDecoded_(TypeList<>, StringView fmt, const char* data, std::string& dest, Decoded&... values) {
+  fmt::basic_memory_buffer<char, 256> buf;
+  fmt::detail::vformat_to(buf, fmt::string_view(fmt.data(), fmt.size()), fmt::make_format_args(values...));
+  dest.assign(buf.data(), buf.size());
+}
+
+template <typename T, typename... Rest, typename... Decoded>
+void FormatDecoded_(TypeList<T, Rest...>, StringView fmt, const char* data, std::string& dest, Decoded&... values) {
+  auto value = DecodeArg<T>(data);
+  FormatDecoded_(TypeList<Rest...>{}, fmt, data, dest, values..., value);
+}
+
+// 后台格式化入口, 其地址作为DeferredArgs::FormatFn随记录传递
+template <typename... Args>
+void FormatDeferred(StringView fmt, const char* data, std::string& dest) {
+  if (fmt.data() == nullptr) {
+    fmt = DecodeArg<std::string_view>(data);
+  }
+  FormatDecoded_(TypeList<RemoveCVRef<Args>...>{}, fmt, data, dest);
+}
+
+}  // namespace formatter
+}  // namespace logger
@@ -0,0 +1,122 @@
+#include "formatter/compact_formatter.h"
+
+#include "log_site.h"
+#include "proto/effective_msg.pb.h"
+
+namespace logger {
+namespace formatter {
+
+static void PutVarint(uint64_t value, std::string& dest) {
+  while (value >= 0x80) {
+    dest.push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  dest.push_back(static_cast<char>(value));
+}
+
+static void PutString(StringView str, std::string& dest) {
+  PutVarint(str.size(), dest);
+  dest.append(str.data(), str.size());
+}
+
+static bool GetVarint(StringView& data, uint64_t& value) {
+  value = 0;
+  for (uint32_t shift = 0; shift < 64 && !data.empty(); shift += 7) {
+    uint8_t byte = static_cast<uint8_t>(data.front());
+    data.remove_prefix(1);
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool GetString(StringView& data, StringView& str) {
+  uint64_t len = 0;
+  if (!GetVarint(data, len) || len > data.size()) {
+    return false;
+  }
+  str = data.substr(0, len);
+  data.remove_prefix(len);
+  return true;
+}
+
+void CompactFormatter::Format(const LogMsg& msg, std::string& dest) {
+  dest.clear();
+  PutVarint(msg.site->id, dest);
+  PutVarint(std::chrono::duration_cast<std::chrono::microseconds>(msg.time.time_since_epoch()).count(), dest);
+  PutVarint(logger::utils::GetProcessID(), dest);
+  PutVarint(msg.thread_id, dest);
+  PutString(msg.message, dest);
+}
+
+void CompactFormatter::FormatSiteTable(uint32_t first_id, uint32_t last_id, std::string& dest) {
+  dest.clear();
+  PutVarint(last_id - first_id, dest);
+  for (uint32_t id = first_id + 1; id <= last_id; ++id) {
+    const LogSite* site = LogSiteRegistry::Instance().Get(id);
+    PutVarint(id, dest);
+    PutVarint(static_cast<uint64_t>(site->level), dest);
+    PutVarint(static_cast<uint64_t>(site->location.line), dest);
+    PutString(site->location.file_name, dest);
+    PutString(site->location.func_name, dest);
+    PutString(site->fmt, dest);
+  }
+}
+
+bool CompactFormatter::ParseSiteTable(StringView data, SiteTable& table) {
+  uint64_t count = 0;
+  if (!GetVarint(data, count)) {
+    return false;
+  }
+  for (uint64_t i = 0; i < count; ++i) {
+    uint64_t id = 0;
+    uint64_t level = 0;
+    uint64_t line = 0;
+    StringView file_name;
+    StringView func_name;
+    StringView fmt;
+    if (!GetVarint(data, id) || !GetVarint(data, level) || !GetVarint(data, line) || !GetString(data, file_name) ||
+        !GetString(data, func_name) || !GetString(data, fmt)) {
+      return false;
+    }
+    auto iter = kLogLevelMap.find(static_cast<LogLevel>(level));
+    SiteInfo& info = table[static_cast<uint32_t>(id)];
+    info.level = iter != kLogLevelMap.end() ? iter->second : std::string();
+    info.line = static_cast<int32_t>(line);
+    info.file_name.assign(file_name.data(), file_name.size());
+    info.func_name.assign(func_name.data(), func_name.size());
+    info.fmt.assign(fmt.data(), fmt.size());
+  }
+  return true;
+}
+
+bool CompactFormatter::ParseRecord(StringView data, const SiteTable& table, EffectiveMsg& msg) {
+  uint64_t site_id = 0;
+  uint64_t timestamp = 0;
+  uint64_t pid = 0;
+  uint64_t tid = 0;
+  StringView message;
+  if (!GetVarint(data, site_id) || !GetVarint(data, timestamp) || !GetVarint(data, pid) || !GetVarint(data, tid) ||
+      !GetString(data, message)) {
+    return false;
+  }
+  auto iter = table.find(static_cast<uint32_t>(site_id));
+  if (iter == table.end()) {
+    return false;
+  }
+  const SiteInfo& site = iter->second;
+  msg.set_level(site.level);
+  msg.set_timestamp(static_cast<int64_t>(timestamp));
+  msg.set_pid(static_cast<int32_t>(pid));
+  msg.set_tid(static_cast<int32_t>(tid));
+  msg.set_line(site.line);
+  msg.set_file_name(site.file_name);
+  msg.set_func_name(site.func_name);
+  msg.set_log_info(message.data(), message.size());
+  return true;
+}
+
+}  // namespace formatter
+}  // namespace logger
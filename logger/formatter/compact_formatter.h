@@ -0,0 +1,45 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "formatter/formatter.h"
+
+class EffectiveMsg;
+
+namespace logger {
+namespace formatter {
+
+/**
+ * @brief 带日志点id的紧凑记录格式
+ *
+ * 记录: [site_id][timestamp][pid][tid][message], 整数均为varint编码
+ * 日志点表: [count]{[id][level][line][file_name][func_name][fmt]}..., 字符串为[varint长度][内容]
+ * 日志点表在每个chunk中按需写入一次, 解码端据此还原文件名、函数名、级别等字段
+ */
+class CompactFormatter : public Formatter {
+ public:
+  // 解码端保存的日志点信息
+  struct SiteInfo {
+    std::string level;
+    int32_t line{0};
+    std::string file_name;
+    std::string func_name;
+    std::string fmt;
+  };
+  using SiteTable = std::unordered_map<uint32_t, SiteInfo>;
+
+  // 编码记录, 要求msg.site非空
+  void Format(const LogMsg& msg, std::string& dest) override;
+
+  // 编码id在(first_id, last_id]范围内的日志点
+  static void FormatSiteTable(uint32_t first_id, uint32_t last_id, std::string& dest);
+
+  // 解码日志点表并合并到table
+  static bool ParseSiteTable(StringView data, SiteTable& table);
+
+  // 解码记录, 结合日志点表还原为EffectiveMsg
+  static bool ParseRecord(StringView data, const SiteTable& table, EffectiveMsg& msg);
+};
+
+}  // namespace formatter
+}  // namespace logger
@@ -8,10 +8,9 @@ void EffectiveFormatter::Format(const LogMsg& msg, std::string& dest) {
   EffectiveMsg effective_msg;
   effective_msg.set_level(kLogLevelMap.at(msg.level));
   effective_msg.set_timestamp(
-      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
-          .count());
+      std::chrono::duration_cast<std::chrono::microseconds>(msg.time.time_since_epoch()).count());
   effective_msg.set_pid(logger::utils::GetProcessID());
-  effective_msg.set_tid(logger::utils::GetThreadID());
+  effective_msg.set_tid(msg.thread_id);
   effective_msg.set_line(msg.location.line);
   effective_msg.set_file_name(msg.location.file_name.data(), msg.location.file_name.size());
   effective_msg.set_func_name(msg.location.func_name.data(), msg.location.func_name.size());
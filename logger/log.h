@@ -2,14 +2,24 @@
 
 #include "log_common.h"
 #include "log_factory.h"
+#include "log_site.h"
 #include "logger.h"
 
 #define EXT_LOGGER_INIT(log) logger::LogFactory::Instance().SetLogger(log)
 
-#define LOGGER_CALL(log, level, ...)                                                                      \
-  if (log) {                                                                                              \
-    (log)->Log(logger::SourceLocation{__FILE__, __LINE__, static_cast<const char*>(__FUNCTION__)}, level, \
-                  __VA_ARGS__);                                                                              \
+// 取可变参数中的第一个(格式串), LOGGER_EXPAND兼容MSVC传统预处理器
+#define LOGGER_EXPAND(x) x
+#define LOGGER_FIRST_ARG_(first, ...) first
+#define LOGGER_FIRST_ARG(...) LOGGER_EXPAND(LOGGER_FIRST_ARG_(__VA_ARGS__, 0))
+
+// 源码位置在编译期生成(包括截取文件名); 每个宏展开处只在第一次执行时注册日志点, 之后只传递静态描述
+#define LOGGER_CALL(log, level, ...)                                                                   \
+  if (log) {                                                                                           \
+    static constexpr logger::SourceLocation _logger_location{__FILE__, __LINE__,                       \
+                                                             static_cast<const char*>(__FUNCTION__)};  \
+    static const logger::LogSite& _logger_site = logger::LogSiteRegistry::Instance().Register(        \
+        _logger_location, level, logger::detail::SiteFormat(LOGGER_FIRST_ARG(__VA_ARGS__)));           \
+    (log)->Log(_logger_site, __VA_ARGS__);                                                             \
   }
 
 #if LOGGER_ACTIVE_LEVEL <= LOGGER_LEVEL_TRACE
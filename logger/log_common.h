@@ -34,25 +34,23 @@ enum class LogLevel {
   kOff = LOGGER_LEVEL_OFF
 };
 
+namespace detail {
+// 截取路径中的文件名, 同时支持Unix('/')与windows('\\')分隔符; 常量实参时在编译期完成
+constexpr StringView Basename(StringView path) {
+  for (size_t i = path.size(); i > 0; --i) {
+    if (path[i - 1] == '/' || path[i - 1] == '\\') {
+      return path.substr(i);
+    }
+  }
+  return path;
+}
+}  // namespace detail
+
 struct SourceLocation {
   constexpr SourceLocation() = default;
 
-  SourceLocation(StringView file_name_in, int32_t line_in, StringView func_name_in)
-      : file_name{file_name_in}, line{line_in}, func_name{func_name_in} {
-    // 获取文件名
-    if (!file_name.empty()) {
-      size_t pos = file_name.rfind('/');  // Unix文件路径分隔
-      if (pos != StringView::npos) {
-        // 截取'/'之后
-        file_name = file_name.substr(pos + 1);
-      } else {
-        pos = file_name.rfind('\\');  // windows文件路径分割
-        if (pos != StringView::npos) {
-          file_name = file_name.substr(pos + 1);
-        }
-      }
-    }
-  }
+  constexpr SourceLocation(StringView file_name_in, int32_t line_in, StringView func_name_in)
+      : file_name{detail::Basename(file_name_in)}, line{line_in}, func_name{func_name_in} {}
 
   StringView file_name;
   int32_t line{0};
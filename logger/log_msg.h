@@ -1,11 +1,33 @@
 #pragma once
 
 #include "log_common.h"
+#include "log_site.h"
+#include "utils/sys_util.h"
+
 namespace logger {
 
+// 延迟格式化的参数: 格式串(需为静态存储, 如字符串字面量) + 参数包的二进制编码
+// format_fn按编译期记录的参数类型解码data并格式化到dest
+struct DeferredArgs {
+  using FormatFn = void (*)(StringView fmt, const char* data, std::string& dest);
+
+  void Format(std::string& dest) const { format_fn(fmt, data.data(), dest); }
+
+  StringView fmt;  // 字面量格式串, 为空(data()为nullptr)时格式串编码在data开头
+  StringView data;
+  FormatFn format_fn{nullptr};
+};
+
 struct LogMsg {
+  // 时间与线程在调用处采集, 异步sink在后台格式化时仍能得到正确值
   LogMsg(SourceLocation loc, LogLevel lvl, StringView msg)
-      : location(std::move(loc)), level(lvl), message(std::move(msg)) {}
+      : location(std::move(loc)),
+        level(lvl),
+        message(std::move(msg)),
+        time(std::chrono::system_clock::now()),
+        thread_id(utils::GetThreadID()) {}
+  LogMsg(SourceLocation loc, LogLevel lvl, StringView msg, std::chrono::system_clock::time_point t, size_t tid)
+      : location(std::move(loc)), level(lvl), message(std::move(msg)), time(t), thread_id(tid) {}
   LogMsg(LogLevel lvl, StringView msg) : LogMsg(SourceLocation{}, lvl, msg) {}
 
   LogMsg(const LogMsg& other) = default;
@@ -14,6 +36,10 @@ struct LogMsg {
   SourceLocation location;
   LogLevel level;
   StringView message;
+  std::chrono::system_clock::time_point time;
+  size_t thread_id{0};
+  const DeferredArgs* deferred{nullptr};  // 非空时message为空, 由sink自行格式化
+  const LogSite* site{nullptr};           // 经EXT_LOG_*宏记录时指向静态注册的日志点
 };
 
 }  // namespace logger
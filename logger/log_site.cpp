@@ -0,0 +1,33 @@
+#include "log_site.h"
+
+namespace logger {
+
+LogSiteRegistry& LogSiteRegistry::Instance() {
+  static LogSiteRegistry instance;
+  return instance;
+}
+
+const LogSite& LogSiteRegistry::Register(SourceLocation location, LogLevel level, StringView fmt) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  LogSite& site = sites_.emplace_back();
+  site.id = static_cast<uint32_t>(sites_.size());
+  site.level = level;
+  site.location = location;
+  site.fmt = fmt;
+  return site;
+}
+
+const LogSite* LogSiteRegistry::Get(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  if (id == 0 || id > sites_.size()) {
+    return nullptr;
+  }
+  return &sites_[id - 1];
+}
+
+uint32_t LogSiteRegistry::Size() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return static_cast<uint32_t>(sites_.size());
+}
+
+}  // namespace logger
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+
+#include "log_common.h"
+
+namespace logger {
+
+// 日志点的静态描述: 每个EXT_LOG_*宏展开处注册一次, 之后记录只携带id
+struct LogSite {
+  uint32_t id{0};  // 从1开始递增
+  LogLevel level{LogLevel::kInfo};
+  SourceLocation location;
+  StringView fmt;  // 格式串, 非字面量格式串时为空
+};
+
+class LogSiteRegistry {
+ public:
+  LogSiteRegistry(const LogSiteRegistry&) = delete;
+  LogSiteRegistry& operator=(const LogSiteRegistry&) = delete;
+
+  static LogSiteRegistry& Instance();
+
+  // 注册日志点并返回其描述, 返回的引用在进程生命周期内有效
+  const LogSite& Register(SourceLocation location, LogLevel level, StringView fmt);
+
+  // 根据id获取日志点, 不存在时返回nullptr
+  const LogSite* Get(uint32_t id);
+
+  // 已注册的日志点个数, 即当前最大id
+  uint32_t Size();
+
+ private:
+  LogSiteRegistry() = default;
+
+  std::mutex mtx_;
+  std::deque<LogSite> sites_;  // deque尾部插入不会使已有元素的引用失效
+};
+
+namespace detail {
+// 从宏的第一个参数中取出字面量格式串, 其他类型(如fmt::runtime)返回空
+constexpr StringView SiteFormat(const char* fmt) {
+  return StringView(fmt);
+}
+template <typename T>
+constexpr StringView SiteFormat(const T&) {
+  return StringView();
+}
+}  // namespace detail
+
+}  // namespace logger
@@ -42,8 +42,26 @@ void Logger::Log(LogLevel level, SourceLocation loc, StringView message) {
 }
 
 void Logger::Log_(const LogMsg& msg) {
+  if (!msg.deferred) {
+    for (auto& sink : sinks_) {
+      sink->Log(msg);
+    }
+    return;
+  }
+  // 延迟格式化的消息: 只为不支持的sink格式化一次
+  std::string formatted;
+  LogMsg formatted_msg(msg);
   for (auto& sink : sinks_) {
-    sink->Log(msg);
+    if (sink->SupportDeferred()) {
+      sink->Log(msg);
+      continue;
+    }
+    if (formatted_msg.deferred) {
+      msg.deferred->Format(formatted);
+      formatted_msg.message = formatted;
+      formatted_msg.deferred = nullptr;
+    }
+    sink->Log(formatted_msg);
   }
 }
 
@@ -32,6 +32,12 @@ bool MMapper::TryMap_(size_t capacity) {
   return handle_ != NULL;
 }
 
+bool MMapper::TryRemap_(size_t capacity) {
+  // 视图无法原地扩展, 重新映射
+  Unmap_();
+  return TryMap_(capacity);
+}
+
 void MMapper::Unmap_() {
   if (handle_) {
     UnmapViewOfFile(handle_);
@@ -39,11 +45,14 @@ void MMapper::Unmap_() {
   handle_ = NULL;
 }
 
-void MMapper::Sync_() {
-  if (handle_) {
-    FlushViewOfFile(handle_, capacity_);
+void MMapper::CloseFile_() {}
+
+void MMapper::Sync(const Region& region, bool async) {
+  // FlushViewOfFile只发起回写, 没有保存文件句柄, 无法等待写入完成
+  if (region.address) {
+    FlushViewOfFile(region.address, region.size);
   }
-} 
+}
 
 } // namespace mmap
 }  // namespace logger
@@ -1,5 +1,8 @@
 #include <string.h>
+#include <algorithm>
+#include <atomic>
 
+#include "helpers/internal_log.h"
 #include "mmap/mmapper.h"
 #include "utils/file_util.h"
 #include "utils/sys_util.h"
@@ -7,19 +10,27 @@
 namespace logger {
 namespace mmap {
 
-static constexpr size_t kDefaultCapacity = 512 * 1024;  // 512KB
-
-MMapper::MMapper(FilePath file_path) : file_path_(std::move(file_path)), mmaped_address_(nullptr), capacity_(0) {
-  size_t file_size = logger::filesystem::GetFileSize(file_path);
-  Reserve_(std::max(file_size, kDefaultCapacity));
+MMapper::MMapper(FilePath file_path, size_t capacity, uint32_t options)
+    : file_path_(std::move(file_path)), mmaped_address_(nullptr), capacity_(0), options_(options) {
+  size_t file_size = logger::filesystem::GetFileSize(file_path_);
+  Reserve_(std::max(file_size, capacity));
   Init_();
 }
 
+MMapper::~MMapper() {
+  Unmap_();
+  CloseFile_();
+}
+
 void MMapper::Resize(size_t new_size) {
   if (!IsValid_()) {
     return;
   }
   EnsureCapacity_(new_size);
+  if (new_size + sizeof(MmapHeader) > capacity_) {
+    return;
+  }
+  staged_ = 0;
   GetHeader_()->size = new_size;
 }
 
@@ -34,10 +45,12 @@ void MMapper::Reserve_(size_t new_capcity) {
   if (new_capcity == capacity_) {
     return;
   }
-  // 解除原有映射
-  Unmap_();
-  // 映射分配新内存
-  TryMap_(new_capcity);
+  // 已有映射时原地扩展(必要时移动)映射, 否则新建映射
+  bool mapped = mmaped_address_ ? TryRemap_(new_capcity) : TryMap_(new_capcity);
+  if (!mapped) {
+    LOG_ERROR("MMapper::Reserve_: map {} bytes failed", new_capcity);
+    return;
+  }
   capacity_ = new_capcity;
 }
 
@@ -91,6 +104,7 @@ size_t MMapper::Size() const {
 }
 
 void MMapper::Clear() {
+  staged_ = 0;
   if (!IsValid_()) {
     return;
   }
@@ -98,13 +112,47 @@ void MMapper::Clear() {
 }
 
 void MMapper::Push(const void* data, size_t size) {
+  if (Stage(data, size)) {
+    Commit();
+  }
+}
+
+bool MMapper::Stage(const void* data, size_t size) {
   if (!IsValid_()) {
+    return false;
+  }
+  size_t offset = Size() + staged_;
+  EnsureCapacity_(offset + size);
+  // 扩容失败时放弃本次提交的全部内容, 不留下不完整的记录
+  if (offset + size + sizeof(MmapHeader) > capacity_) {
+    staged_ = 0;
+    return false;
+  }
+  // 扩容可能移动映射, 重新取得Data()
+  memcpy(Data() + offset, data, size);
+  staged_ += size;
+  return true;
+}
+
+void MMapper::Commit() {
+  if (staged_ == 0 || !IsValid_()) {
     return;
   }
-  size_t new_size = Size() + size;
-  EnsureCapacity_(new_size);
-  memcpy(Data() + Size(), data, size);
-  GetHeader_()->size = new_size;
+  // 阻止编译器和CPU把内容的写入重排到size之后
+  std::atomic_thread_fence(std::memory_order_release);
+  GetHeader_()->size = static_cast<uint32_t>(Size() + staged_);
+  staged_ = 0;
+}
+
+MMapper::Region MMapper::Committed() const {
+  if (!IsValid_()) {
+    return {nullptr, 0};
+  }
+  return {mmaped_address_, sizeof(MmapHeader) + Size()};
+}
+
+void MMapper::Sync(bool async) {
+  Sync(Committed(), async);
 }
 
 void MMapper::EnsureCapacity_(size_t new_size) {
@@ -112,12 +160,8 @@ void MMapper::EnsureCapacity_(size_t new_size) {
   if (real_size <= capacity_) {
     return;
   }
-  size_t new_capacity = capacity_;
-  // 以page_size整数倍扩容capacity
-  while(new_capacity < real_size){
-    new_capacity+=logger::utils::GetPageSize();
-  }
-
+  // 按倍数扩容, 持续增长时每次Push的扩容开销均摊为O(1); Reserve_会调整为page_size的整数倍
+  size_t new_capacity = std::max(real_size, capacity_ * 2);
   Reserve_(new_capacity);
 }
 
@@ -128,5 +172,12 @@ double MMapper::GetRatio() const {
   return static_cast<double>(Size()) / (Capacity_() - sizeof(MmapHeader));
 }
 
+size_t MMapper::Available() const {
+  if (!IsValid_()) {
+    return 0;
+  }
+  return Capacity_() - sizeof(MmapHeader) - Size() - staged_;
+}
+
 }  // namespace mmap
 }  // namespace logger
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stdint.h>
 #include <filesystem>
 #include <memory>
 
@@ -10,9 +11,19 @@ class MMapper {
  public:
   using FilePath = std::filesystem::path;
 
-  explicit MMapper(FilePath file_path);
+  static constexpr size_t kDefaultCapacity = 512 * 1024;  // 512KB
 
-  ~MMapper() = default;
+  // 映射选项, 可按位组合, 不支持的系统忽略
+  enum MapOption : uint32_t {
+    kPopulate = 0x1,    // 映射时预先触发写缺页(MADV_POPULATE_WRITE, 旧内核逐页写入), 避免热路径上的首次缺页
+    kHugePage = 0x2,    // MADV_HUGEPAGE, 需要缓存目录所在文件系统支持透明大页(如huge=advise挂载的tmpfs)
+    kSequential = 0x4,  // MADV_SEQUENTIAL
+  };
+
+  // capacity为初始映射大小, 已有文件更大时按文件大小映射; options为MapOption的组合
+  explicit MMapper(FilePath file_path, size_t capacity = kDefaultCapacity, uint32_t options = 0);
+
+  ~MMapper();
   MMapper(const MMapper& other) = delete;
   MMapper& operator=(MMapper other) = delete;
 
@@ -24,13 +35,52 @@ class MMapper {
 
   void Clear();
 
+  // 追加并立即提交, 相当于Stage后Commit
   void Push(const void* data, size_t size);
 
+  // 在已提交内容之后写入data但不计入Size(), 由Commit一次性提交; 扩容失败时丢弃全部未提交内容并返回false
+  // 头部的size是唯一的提交标记: 进程在提交前崩溃时, 恢复只会看到上一次提交为止的完整内容
+  bool Stage(const void* data, size_t size);
+
+  // 提交Stage写入的内容, 内容先于size可见
+  void Commit();
+
+  // 丢弃未提交的内容
+  void Rollback() { staged_ = 0; }
+
+  size_t Staged() const { return staged_; }
+
   // mmap实际内容与mmap所占空间比率
   double GetRatio() const;
 
+  // 不扩容还能写入的字节数(已扣除未提交内容)
+  size_t Available() const;
+
   bool Empty() const { return Size() == 0; }
 
+  const FilePath& Path() const { return file_path_; }
+
+  // 映射的文件在MMapper生命周期内保持打开, Linux下为fd, 不保持打开的系统为-1
+  intptr_t FileHandle() const { return file_handle_; }
+
+  // Data()在映射文件中的偏移
+  static constexpr size_t DataOffset() { return sizeof(MmapHeader); }
+
+  // 已写入内容(含头部)落盘, async为true时只发起回写不等待完成
+  void Sync(bool async = false);
+
+  // 映射中的一段内存
+  struct Region {
+    void* address;
+    size_t size;
+  };
+
+  // 已提交内容(含头部)所在的区域, 调用方可以在释放写入锁之后再对其落盘
+  Region Committed() const;
+
+  // 区域落盘; 期间映射被扩展移动时只是落盘失败, 由下一次落盘补上
+  static void Sync(const Region& region, bool async = false);
+
  private:
   // 内存映射的头部
   struct MmapHeader {
@@ -45,8 +95,6 @@ class MMapper {
 
   size_t Capacity_() const noexcept { return capacity_; }
 
-  void Sync_();
-
   bool IsValid_() const;
 
   MmapHeader* GetHeader_() const;
@@ -56,11 +104,18 @@ class MMapper {
   // 根据系统不同有不同实现
   bool TryMap_(size_t capacity);  // 分配新内存
   // 根据系统不同有不同实现
+  bool TryRemap_(size_t capacity);  // 扩展已有映射, 文件随之扩展
+  // 根据系统不同有不同实现
   void Unmap_();  // 解除原有映射
+  // 根据系统不同有不同实现
+  void CloseFile_();
 
   FilePath file_path_;
   void* mmaped_address_;  // mmap映射内存的首地址
   size_t capacity_;
+  uint32_t options_;
+  size_t staged_{0};  // 已写入但未提交的字节数
+  intptr_t file_handle_{-1};
 };
 
 }  // namespace mmap
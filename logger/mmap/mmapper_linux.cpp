@@ -2,18 +2,45 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
-#include "helpers/deffer.h"
 #include "mmap/mmapper.h"
 
 namespace logger {
 namespace mmap {
 
-void MMapper::Sync_() {
-  if (mmaped_address_) {
-    msync(mmaped_address_, capacity_, MS_SYNC);
+// 按选项设置映射中[begin, end)的内存建议并预先缺页; 扩展映射时只处理新增部分, 不重复写入已有记录的页
+static void ApplyOptions(void* address, size_t begin, size_t end, uint32_t options) {
+  auto range = static_cast<uint8_t*>(address) + begin;
+  size_t size = end - begin;
+#if defined(MADV_HUGEPAGE)
+  if (options & MMapper::kHugePage) {
+    madvise(range, size, MADV_HUGEPAGE);
+  }
+#endif
+  if (options & MMapper::kSequential) {
+    madvise(range, size, MADV_SEQUENTIAL);
+  }
+  if (options & MMapper::kPopulate) {
+#if defined(MADV_POPULATE_WRITE)
+    if (madvise(range, size, MADV_POPULATE_WRITE) == 0) {
+      return;
+    }
+#endif
+    // 共享映射的MAP_POPULATE只建立只读页表, 首次写入仍会缺页, 因此逐页原值写回
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    auto data = static_cast<volatile uint8_t*>(range);
+    for (size_t offset = 0; offset < size; offset += page_size) {
+      data[offset] = data[offset];
+    }
   }
 }
 
+void MMapper::Sync(const Region& region, bool async) {
+  if (!region.address) {
+    return;
+  }
+  msync(region.address, region.size, async ? MS_ASYNC : MS_SYNC);
+}
+
 void MMapper::Unmap_() {
   if (mmaped_address_) {
     munmap(mmaped_address_, capacity_);
@@ -21,22 +48,50 @@ void MMapper::Unmap_() {
   mmaped_address_ = NULL;
 }
 
+void MMapper::CloseFile_() {
+  if (file_handle_ != -1) {
+    close(static_cast<int>(file_handle_));
+  }
+  file_handle_ = -1;
+}
+
 bool MMapper::TryMap_(size_t capacity) {
-  int fd = open(file_path_.string().c_str(), O_RDWR | O_CREAT, S_IRWXU);
-  LOG_DEFER {
-    if (fd != -1) {
-      close(fd);
-    }
-  };
+  // 文件保持打开, 扩容和写日志文件时(CopyFrom)不再打开
+  if (file_handle_ == -1) {
+    file_handle_ = open(file_path_.string().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRWXU);
+  }
+  int fd = static_cast<int>(file_handle_);
+  if (fd == -1 || ftruncate(fd, capacity) != 0) {
+    return false;
+  }
 
-  if (fd == -1) {
+  void* address = ::mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (address == MAP_FAILED) {
     return false;
-  } else {
-    ftruncate(fd, capacity);
   }
+  mmaped_address_ = address;
+  ApplyOptions(mmaped_address_, 0, capacity, options_);
+  return true;
+}
 
-  mmaped_address_ = ::mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-  return mmaped_address_ != MAP_FAILED;
+bool MMapper::TryRemap_(size_t capacity) {
+#if defined(__linux__)
+  if (file_handle_ == -1 || ftruncate(static_cast<int>(file_handle_), capacity) != 0) {
+    return false;
+  }
+  // mremap直接扩展页表, 不需要munmap后重新mmap
+  void* address = ::mremap(mmaped_address_, capacity_, capacity, MREMAP_MAYMOVE);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  mmaped_address_ = address;
+  ApplyOptions(mmaped_address_, capacity_, capacity, options_);
+  return true;
+#else
+  // 没有mremap的系统重新映射
+  Unmap_();
+  return TryMap_(capacity);
+#endif
 }
 
 }  // namespace mmap
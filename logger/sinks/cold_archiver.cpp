@@ -0,0 +1,279 @@
+#include "sinks/cold_archiver.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "helpers/internal_log.h"
+#include "sinks/effective_sink.h"
+#include "utils/crc32c.h"
+#include "utils/file_util.h"
+#include "utils/file_writer.h"
+#include "zstd.h"
+
+namespace logger {
+namespace sink {
+
+// 一个冷归档chunk最多包含的未压缩item字节数, 不超过zstd解压默认允许的窗口(128MB)
+static constexpr size_t kMaxColdChunkItems = 64 * 1024 * 1024;
+// 长距离匹配的窗口, 2^27为解压端不额外设置时允许的最大窗口
+static constexpr int kColdWindowLog = 27;
+// 分段送入压缩器(同一帧内flush), 每段之间检查是否取消; 19级约1MB/s
+static constexpr size_t kColdSliceSize = 1024 * 1024;
+
+ColdArchiver::ColdArchiver(const std::string& shared_secret,
+                           const std::string& client_pub_key,
+                           crypt::CipherType cipher,
+                           const std::string& dict,
+                           int level)
+    : shared_secret_(shared_secret), client_pub_key_(client_pub_key), cipher_(cipher), dict_(dict) {
+  if (!dict_.empty()) {
+    dict_id_ = ZSTD_getDictID_fromDict(dict_.data(), dict_.size());
+  }
+  if (cipher_ != crypt::CipherType::kNone) {
+    crypt_ = std::make_unique<crypt::AESCrypt>(shared_secret_);
+    if (cipher_ != crypt::CipherType::kAesCbc) {
+      stream_crypt_ = std::make_unique<crypt::AESStreamCrypt>(shared_secret_, cipher_);
+    }
+  }
+  compress_ = compress::CreateCompression(compress::CompressType::kZstd, level);
+  compress_->EnableLongDistance(kColdWindowLog);
+}
+
+size_t ColdArchiver::Archive(const std::filesystem::path& src,
+                             const std::filesystem::path& dst,
+                             const std::atomic<bool>& cancelled) {
+  std::string input = filesystem::ReadFile(src);
+  std::string output;
+  std::string items;
+  // 冷归档chunk的索引由各源chunk的索引合并而成, 有源chunk没有索引时不写索引
+  detail::ChunkIndex index;
+  bool indexed = true;
+  size_t recompressed = 0;
+  // 依次处理每个chunk, 不能重新压缩的chunk原样输出, 保持记录顺序
+  auto flush_items = [&]() -> bool {
+    if (items.empty()) {
+      return true;
+    }
+    bool ret = EncodeChunk_(items, indexed ? &index : nullptr, output, cancelled);
+    items.clear();
+    index = detail::ChunkIndex();
+    indexed = true;
+    return ret;
+  };
+  size_t offset = 0;
+  while (offset < input.size()) {
+    if (cancelled.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+    auto chunk_header = reinterpret_cast<const detail::ChunkHeader*>(input.data() + offset);
+    size_t remaining = input.size() - offset;
+    size_t header_size = remaining >= sizeof(uint64_t) ? detail::ChunkHeader::HeaderSize(chunk_header->magic) : 0;
+    if (header_size == 0 || header_size > remaining || chunk_header->size > remaining - header_size) {
+      LOG_ERROR("ColdArchiver::Archive: invalid chunk in {}", src.string());
+      return 0;
+    }
+    const char* data = input.data() + offset + header_size;
+    size_t chunk_size = header_size + chunk_header->size;
+    size_t items_size = items.size();
+    detail::ChunkIndex chunk_index;
+    bool has_index =
+        CanDecode_(*chunk_header) &&
+        detail::ChunkIndex::Find(chunk_header->flags, data, chunk_header->size, shared_secret_, chunk_index);
+    size_t data_size =
+        has_index ? chunk_header->size - detail::ChunkIndex::ItemSize(chunk_header->flags) : chunk_header->size;
+    if (CanDecode_(*chunk_header) && DecodeChunk_(*chunk_header, data, data_size, items)) {
+      ++recompressed;
+      if (has_index) {
+        index.Merge(chunk_index);
+      } else {
+        indexed = false;
+      }
+      if (items.size() >= kMaxColdChunkItems && !flush_items()) {
+        return 0;
+      }
+    } else {
+      // 解码失败时丢弃该chunk已解出的部分, 整个chunk原样输出
+      items.resize(items_size);
+      if (!flush_items()) {
+        return 0;
+      }
+      output.append(input.data() + offset, chunk_size);
+    }
+    offset += chunk_size;
+  }
+  if (recompressed == 0 || !flush_items()) {
+    return 0;
+  }
+  // 落盘后再由调用方替换原文件, 避免崩溃时两者都不完整
+  filesystem::FileWriter writer;
+  std::error_code ec;
+  std::filesystem::remove(dst, ec);
+  if (!writer.Open(dst, 0) || !writer.Write(output.data(), output.size()) || !writer.Sync()) {
+    LOG_ERROR("ColdArchiver::Archive: write {} failed", dst.string());
+    return 0;
+  }
+  writer.Close();
+  return output.size();
+}
+
+bool ColdArchiver::CanDecode_(const detail::ChunkHeader& chunk_header) const {
+  if (chunk_header.magic != detail::ChunkHeader::kMagic || (chunk_header.flags & detail::ChunkHeader::kCold)) {
+    return false;
+  }
+  if (chunk_header.dict_id != 0 && chunk_header.dict_id != dict_id_) {
+    return false;
+  }
+  // 加密的chunk只有本进程的密钥能解开
+  if (chunk_header.cipher == crypt::CipherType::kNone) {
+    return true;
+  }
+  return chunk_header.cipher == cipher_ && crypt_ &&
+         memcmp(chunk_header.pub_key, client_pub_key_.data(), client_pub_key_.size()) == 0;
+}
+
+bool ColdArchiver::DecodeChunk_(const detail::ChunkHeader& chunk_header,
+                                const char* data,
+                                size_t size,
+                                std::string& items) {
+  std::string iv(chunk_header.iv, sizeof(chunk_header.iv));
+  bool encrypted = chunk_header.cipher != crypt::CipherType::kNone;
+  if (encrypted) {
+    if (stream_crypt_) {
+      stream_crypt_->DecryptInit(iv);
+    } else {
+      crypt_->SetIV(iv);
+    }
+  }
+  auto decompress = compress::CreateCompression(chunk_header.compress, 0);
+  if (chunk_header.dict_id != 0 && !decompress->SetDictionary(dict_)) {
+    return false;
+  }
+  std::string decrypted;
+  bool checked = chunk_header.flags & detail::ChunkHeader::kItemCrc;
+  size_t item_header_size = detail::ItemHeader::Size(chunk_header.flags);
+  size_t offset = 0;
+  while (offset + item_header_size <= size) {
+    auto item_header = reinterpret_cast<const detail::ItemHeader*>(data + offset);
+    offset += item_header_size;
+    if (item_header->size > size - offset) {
+      return false;
+    }
+    const char* item = data + offset;
+    offset += item_header->size;
+    // 校验不通过的chunk原样保留
+    if (checked) {
+      uint32_t crc;
+      memcpy(&crc, item - sizeof(crc), sizeof(crc));
+      if (crc != detail::ItemHeader::Checksum(*item_header, item, item_header->size)) {
+        LOG_ERROR("ColdArchiver::DecodeChunk_: item checksum mismatch");
+        return false;
+      }
+    }
+    if (!encrypted) {
+      decrypted.assign(item, item_header->size);
+    } else if (stream_crypt_) {
+      decrypted.assign(item, item_header->size);
+      if (!stream_crypt_->Decrypt(decrypted.data(), decrypted.size())) {
+        return false;
+      }
+    } else {
+      decrypted = crypt_->Decrypt(item, item_header->size);
+    }
+    std::string plain = decompress->Uncompress(decrypted.data(), decrypted.size());
+    if (plain.empty()) {
+      return false;
+    }
+    // group item解压后即为item序列, 直接展开
+    if (item_header->magic == detail::ItemHeader::kGroupMagic) {
+      items.append(plain);
+      continue;
+    }
+    detail::ItemHeader plain_header;
+    plain_header.magic = item_header->magic;
+    plain_header.size = static_cast<uint32_t>(plain.size());
+    items.append(reinterpret_cast<const char*>(&plain_header), sizeof(plain_header));
+    items.append(plain);
+  }
+  // GCM chunk校验tag, 未正常结束的chunk没有tag
+  if (stream_crypt_ && (chunk_header.flags & detail::ChunkHeader::kHasTag) &&
+      !stream_crypt_->DecryptFinal(chunk_header.tag)) {
+    LOG_ERROR("ColdArchiver::DecodeChunk_: chunk tag mismatch");
+    return false;
+  }
+  return offset == size;
+}
+
+bool ColdArchiver::EncodeChunk_(const std::string& items,
+                                const detail::ChunkIndex* index,
+                                std::string& output,
+                                const std::atomic<bool>& cancelled) {
+  compress_->ResetStream();
+  compressed_buf_.resize(compress_->CompressedBound(items.size()) + items.size() / kColdSliceSize * 16);
+  size_t compressed_size = 0;
+  for (size_t offset = 0; offset < items.size(); offset += kColdSliceSize) {
+    if (cancelled.load(std::memory_order_relaxed)) {
+      return false;
+    }
+    size_t slice_size = std::min(kColdSliceSize, items.size() - offset);
+    size_t size = compress_->Compress(items.data() + offset, slice_size, compressed_buf_.data() + compressed_size,
+                                      compressed_buf_.size() - compressed_size);
+    if (size == 0) {
+      LOG_ERROR("ColdArchiver::EncodeChunk_: compress failed");
+      return false;
+    }
+    compressed_size += size;
+  }
+  detail::ChunkHeader chunk_header;
+  chunk_header.cipher = cipher_;
+  chunk_header.compress = compress::CompressType::kZstd;
+  chunk_header.flags = detail::ChunkHeader::kCold;
+  memcpy(chunk_header.pub_key, client_pub_key_.data(), std::min(client_pub_key_.size(), sizeof(chunk_header.pub_key)));
+  std::string encrypted;
+  if (!crypt_) {
+    encrypted.assign(compressed_buf_.data(), compressed_size);
+  } else {
+    std::string iv = crypt_->GenerateIV();
+    memcpy(chunk_header.iv, iv.data(), std::min(iv.size(), sizeof(chunk_header.iv)));
+    if (stream_crypt_) {
+      if (!stream_crypt_->EncryptInit(iv) || !stream_crypt_->Encrypt(compressed_buf_.data(), compressed_size) ||
+          !stream_crypt_->EncryptFinal(chunk_header.tag)) {
+        LOG_ERROR("ColdArchiver::EncodeChunk_: encrypt failed");
+        return false;
+      }
+      if (cipher_ == crypt::CipherType::kAesGcm) {
+        chunk_header.flags |= detail::ChunkHeader::kHasTag;
+      }
+      encrypted.assign(compressed_buf_.data(), compressed_size);
+    } else {
+      crypt_->Encrypt(compressed_buf_.data(), compressed_size, encrypted);
+      if (encrypted.empty()) {
+        LOG_ERROR("ColdArchiver::EncodeChunk_: encrypt failed");
+        return false;
+      }
+    }
+  }
+  // 头部在item之后填写大小和校验
+  chunk_header.flags |= detail::ChunkHeader::kItemCrc | detail::ChunkHeader::kHasCrc;
+  size_t header_offset = output.size();
+  output.append(reinterpret_cast<const char*>(&chunk_header), sizeof(chunk_header));
+  uint32_t crc =
+      detail::ItemHeader::AppendChecked(output, detail::ItemHeader::kGroupMagic, encrypted.data(), encrypted.size());
+  uint32_t items_crc = utils::Crc32c(&crc, sizeof(crc));
+  std::string index_payload = index ? index->Encode(crypt_ ? shared_secret_ : std::string()) : std::string();
+  if (!index_payload.empty()) {
+    chunk_header.flags |= detail::ChunkHeader::kHasIndex;
+    if (crypt_) {
+      chunk_header.flags |= detail::ChunkHeader::kIndexEncrypted;
+    }
+    crc = detail::ItemHeader::AppendChecked(output, detail::ItemHeader::kChunkIndexMagic, index_payload.data(),
+                                            index_payload.size());
+    items_crc = utils::Crc32c(&crc, sizeof(crc), items_crc);
+  }
+  chunk_header.size = output.size() - header_offset - sizeof(chunk_header);
+  chunk_header.crc = chunk_header.Checksum(items_crc);
+  memcpy(output.data() + header_offset, &chunk_header, sizeof(chunk_header));
+  return true;
+}
+
+}  // namespace sink
+}  // namespace logger
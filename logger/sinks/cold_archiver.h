@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "compress/compress.h"
+#include "crypt/aes_crypt.h"
+#include "crypt/aes_stream_crypt.h"
+#include "crypt/crypt.h"
+
+namespace logger {
+namespace detail {
+struct ChunkHeader;
+struct ChunkIndex;
+}  // namespace detail
+
+namespace sink {
+
+/**
+ * @brief 把轮转后的日志文件重写为冷归档
+ *
+ * 本进程写入的chunk解密解压后, 其中的item整体以高级别zstd(开启长距离匹配)重新压缩并加密为一个group item,
+ * 写成带ChunkHeader::kCold标记的普通chunk, decoder无需区分。
+ * 其他进程写入的chunk(密钥不同)、旧格式chunk以及已经是冷归档的chunk原样保留。
+ * 非线程安全, 由EffectiveSink的冷归档任务线程独占使用。
+ */
+class ColdArchiver {
+ public:
+  // shared_secret为空时不加密; dict为热文件使用的zstd字典
+  ColdArchiver(const std::string& shared_secret,
+               const std::string& client_pub_key,
+               crypt::CipherType cipher,
+               const std::string& dict,
+               int level);
+
+  // 把src重写到dst并落盘, 返回dst的大小; 失败、被取消或没有可重新压缩的chunk时返回0
+  // 高级别压缩很慢, 处理过程中定期检查cancelled, 置位后尽快返回
+  size_t Archive(const std::filesystem::path& src,
+                 const std::filesystem::path& dst,
+                 const std::atomic<bool>& cancelled);
+
+ private:
+  // 能否由本进程解密解压
+  bool CanDecode_(const detail::ChunkHeader& chunk_header) const;
+
+  // 解密解压chunk中的item, 以未压缩未加密的item序列追加到items
+  bool DecodeChunk_(const detail::ChunkHeader& chunk_header, const char* data, size_t size, std::string& items);
+
+  // items整体压缩加密为一个冷归档chunk追加到output, index非空时写在chunk末尾
+  bool EncodeChunk_(const std::string& items,
+                    const detail::ChunkIndex* index,
+                    std::string& output,
+                    const std::atomic<bool>& cancelled);
+
+  std::string shared_secret_;
+  std::string client_pub_key_;
+  crypt::CipherType cipher_;
+  std::string dict_;
+  uint32_t dict_id_{0};
+  std::unique_ptr<crypt::AESCrypt> crypt_;
+  std::unique_ptr<crypt::AESStreamCrypt> stream_crypt_;
+  std::unique_ptr<compress::Compression> compress_;
+  std::string compressed_buf_;
+};
+
+}  // namespace sink
+}  // namespace logger
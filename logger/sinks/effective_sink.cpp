@@ -1,156 +1,956 @@
 #include "sinks/effective_sink.h"
 
 #include <fmt/core.h>  // 引入fmt库的核心头文件
-#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <unordered_map>
 
 #include "compress/zstd_compress.h"
 #include "compress/zlib_compress.h"
 #include "crypt/aes_crypt.h"
+#include "formatter/compact_formatter.h"
 #include "formatter/effective_formatter.h"
+#include "sinks/cold_archiver.h"
 #include "utils/file_util.h"
 #include "utils/sys_util.h"
 #include "utils/timer_count.h"
 
 namespace logger {
 namespace sink {
-EffectiveSink::EffectiveSink(Conf conf) : conf_(conf) {
+
+// 为每个sink分配唯一id, 作为线程局部环形缓冲区表的键(避免sink析构后地址复用)
+static std::atomic<uint64_t> g_next_sink_id{0};
+
+// 自适应压缩级别每写入多少条item重新评估一次
+static constexpr uint32_t kAdjustLevelInterval = 64;
+
+EffectiveSink::EffectiveSink(Conf conf) : conf_(conf), sink_id_(g_next_sink_id.fetch_add(1)) {
   // 路径不存在则创建
   if (!std::filesystem::exists(conf_.dir)) {
     std::filesystem::create_directories(conf_.dir);
   }
   formatter_ = std::make_unique<formatter::EffectiveFormatter>();  // 初始化formatter_
+  compact_formatter_ = std::make_unique<formatter::CompactFormatter>();
 
   task_runner_ = NEW_TASK_RUNNER(20010305);  // tag为20010305
   // 初始化crypt_
-  auto ecdh_key = crypt::GenECDHKey();
-  auto client_pri = std::get<0>(ecdh_key);
-  client_pub_key_ = std::get<1>(ecdh_key);
-  LOG_INFO("EffectiveSink: client pub size {}", client_pub_key_.size());
-  std::string svr_pub_key_bin = crypt::HexKeyToBinary(conf_.pub_key);
-  // std::string svr_pub_key_bin = conf_.pub_key;
-  std::string shared_secret = crypt::GenECDHSharedSecret(client_pri, svr_pub_key_bin);
-  // LOG_INFO("shared_secret: {}",crypt::BinaryKeyToHex(shared_secret));
-  crypt_ = std::make_unique<crypt::AESCrypt>(shared_secret);
+  if (conf_.cipher != crypt::CipherType::kNone) {
+    auto ecdh_key = crypt::GenECDHKey();
+    auto client_pri = std::get<0>(ecdh_key);
+    client_pub_key_ = std::get<1>(ecdh_key);
+    LOG_INFO("EffectiveSink: client pub size {}", client_pub_key_.size());
+    std::string svr_pub_key_bin = crypt::HexKeyToBinary(conf_.pub_key);
+    // std::string svr_pub_key_bin = conf_.pub_key;
+    shared_secret_ = crypt::GenECDHSharedSecret(client_pri, svr_pub_key_bin);
+    // LOG_INFO("shared_secret: {}",crypt::BinaryKeyToHex(shared_secret));
+    crypt_ = std::make_unique<crypt::AESCrypt>(shared_secret_);
+    if (conf_.cipher != crypt::CipherType::kAesCbc) {
+      stream_crypt_ = std::make_unique<crypt::AESStreamCrypt>(shared_secret_, conf_.cipher);
+    }
+  }
   // 初始化compress_
-  compress_ = std::make_unique<compress::ZstdCompression>();
-  // 初始化master_cache_和slave_cache_
-  master_cache_ = std::make_unique<mmap::MMapper>(conf_.dir / "master_cache");
-  slave_cache_ = std::make_unique<mmap::MMapper>(conf_.dir / "slave_cache");
-  // 创建mmap失败
-  if (!master_cache_ || !slave_cache_) {
-    LOG_ERROR("EffectiveSink::EffectiveSink: create mmap failed");
-    // throw std::runtime_error("EffectiveSink::EffectiveSink: create mmap failed");
-    return;
-  }
-  // 从缓冲区非空,则先将从缓冲区任务写入文件
-  if (!slave_cache_->Empty()) {
-    is_slave_free_.store(true);
-    PrepareToFile_();
-    WAIT_TASK_IDLE(task_runner_);
+  compress_ = compress::CreateCompression(conf_.compress, conf_.compress_level);
+  compress_level_.store(compress_->Level());
+  std::string dict;
+  if (!conf_.dict_path.empty()) {
+    dict = filesystem::ReadFile(conf_.dict_path);
+    if (dict.empty() || !compress_->SetDictionary(dict)) {
+      LOG_ERROR("EffectiveSink::EffectiveSink: load dictionary {} failed", conf_.dict_path.string());
+    }
+  }
+  // raw chunk(包括上次运行遗留的)在写文件时由后台线程压缩, 与写日志的线程各用一个压缩实例
+  file_compress_ = compress::CreateCompression(conf_.compress, conf_.compress_level);
+  if (!dict.empty()) {
+    file_compress_->SetDictionary(dict);
   }
-  // 主缓冲区非空,从缓冲区为空则swap主从缓冲区,然后写入文件
-  if (!master_cache_->Empty()) {
-    if (is_slave_free_) {
-      is_slave_free_.store(false);
-      SwapCache_();
+  // 冷归档在独立的空闲优先级线程中进行, 不与写文件任务竞争
+  if (conf_.cold_archive) {
+    cold_archiver_ =
+        std::make_unique<ColdArchiver>(shared_secret_, client_pub_key_, conf_.cipher, dict, conf_.cold_level);
+    cold_runner_ = NEW_TASK_RUNNER(20010306);
+    POST_TASK(cold_runner_, []() { utils::SetIdlePriority(); });
+  }
+  // 切换阈值超出范围时按不超过1处理, 利用率达到1之前由剩余空间不足触发切换
+  conf_.flush_ratio = std::min(std::max(conf_.flush_ratio, 0.01), 1.0);
+  // 初始化mmap缓存段
+  conf_.cache_segments = std::max<size_t>(conf_.cache_segments, 2);
+  size_t segment_size = space_cast<bytes>(conf_.segment_size).count();
+  for (size_t i = 0; i < conf_.cache_segments; ++i) {
+    auto segment = std::make_unique<CacheSegment>();
+    segment->cache =
+        std::make_unique<mmap::MMapper>(conf_.dir / fmt::format("cache_{}", i), segment_size, conf_.cache_options);
+    if (!segment->cache->Data()) {
+      LOG_ERROR("EffectiveSink::EffectiveSink: create mmap failed");
+      // throw std::runtime_error("EffectiveSink::EffectiveSink: create mmap failed");
+      // 没有缓存段时sink不可用, 之后的记录直接丢弃
+      segments_.clear();
+      return;
     }
-    PrepareToFile_();
+    segments_.push_back(std::move(segment));
   }
+  // io_uring异步写文件, 在途写入数不超过段数, 每段最多一个写请求和一个fdatasync
+  if (conf_.io_uring && file_writer_.EnableAsync(static_cast<unsigned>(2 * conf_.cache_segments))) {
+    RegisterCaches_();
+  }
+  // 上次运行遗留在缓存中的chunk先写入文件, 此时还没有其他线程访问缓存
+  ScanLogFiles_();
+  RecoverCaches_();
+  // 记录后台任务线程, 该线程等待空闲段时直接执行写文件任务
+  POST_TASK(task_runner_, [this]() { runner_thread_id_ = std::this_thread::get_id(); });
+  WAIT_TASK_IDLE(task_runner_);
   // 按时重复日志淘汰检查的任务
-  POST_REPEATED_TASK(task_runner_, [this]() { ElimateFiles_(); }, conf_.interval, -1);
+  repeated_tasks_.push_back(POST_REPEATED_TASK(task_runner_, [this]() { ElimateFiles_(); }, conf_.interval, -1));
+  // 按时将缓存段和日志文件落盘
+  if (conf_.durability >= Durability::kPeriodic) {
+    repeated_tasks_.push_back(POST_REPEATED_TASK(task_runner_, [this]() { SyncCaches_(); }, conf_.sync_interval, -1));
+  }
+  // 按时将有记录的当前段切换出去写入文件, 限制安静时记录在缓存中的停留时间
+  if (conf_.max_flush_latency.count() > 0) {
+    repeated_tasks_.push_back(
+        POST_REPEATED_TASK(task_runner_, [this]() { TimedFlush_(); }, conf_.max_flush_latency, -1));
+  }
+  // 批量模式下按时压缩未攒满的批次, 限制记录在内存中的停留时间
+  if (conf_.batch_size.count() > 0) {
+    repeated_tasks_.push_back(POST_REPEATED_TASK(
+        task_runner_,
+        [this]() {
+          {
+            std::unique_lock<std::mutex> lock(mtx_);
+            WaitActiveFree_(lock);
+            FlushBatch_();
+          }
+          CheckCacheToFile_();
+        },
+        conf_.batch_interval, -1));
+  }
+}
+
+EffectiveSink::~EffectiveSink() {
+  // 取消重复任务并等待已投递的任务执行完, 之后不会再有任务访问this
+  closing_.store(true);
+  for (auto task_id : repeated_tasks_) {
+    CANCEL_REPEATED_TASK(task_id);
+  }
+  WAIT_TASK_IDLE(task_runner_);
+  // 正在进行的冷归档检查到closing_后放弃, 之后的归档任务直接跳过; 再执行已投递到任务线程的替换文件任务
+  if (cold_archiver_) {
+    WAIT_TASK_IDLE(cold_runner_);
+    WAIT_TASK_IDLE(task_runner_);
+  }
+  // 创建缓存段失败时没有需要写入的记录
+  if (segments_.empty()) {
+    return;
+  }
+  // 异步模式下析构前处理完环形缓冲区中剩余的记录
+  if (conf_.async) {
+    POST_TASK(task_runner_, [this]() { DrainRings_(); });
+    WAIT_TASK_IDLE(task_runner_);
+  }
+  // 等待已提交的异步写入完成并释放对应的段, 否则下次启动时会重复写入
+  if (file_writer_.IsAsync()) {
+    POST_TASK(task_runner_, [this]() { CacheToFile_(true); });
+    WAIT_TASK_IDLE(task_runner_);
+  }
+  // 未攒满的批次写入当前段, 下次启动时随缓存恢复
+  std::unique_lock<std::mutex> lock(mtx_);
+  WaitActiveFree_(lock);
+  WriteDropMarker_();
+  FlushBatch_();
+  FinishChunk_();
+  SealChunk_();
 }
 
 void EffectiveSink::Log(const LogMsg& msg) {
+  if (segments_.empty()) {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  bool sync_fatal = conf_.durability >= Durability::kFatalSync && msg.level >= LogLevel::kFatal;
+  // 异步模式只拷贝记录到本线程的环形缓冲区; 超过缓冲区容量的记录走同步路径
+  if (conf_.async && !sync_fatal && PushToRing_(msg)) {
+    return;
+  }
+  // 需要落盘的Fatal记录和超过缓冲区容量的记录在调用线程上写入, 先处理完环形缓冲区保证本线程记录的顺序
+  if (conf_.async) {
+    POST_TASK(task_runner_, [this]() { DrainRings_(); });
+    WAIT_TASK_IDLE(task_runner_);
+  }
+  LogSync_(msg);
+}
+
+void EffectiveSink::LogSync_(const LogMsg& msg) {
   static thread_local std::string buf;
-  // 通过Formatter序列化msg到buf中
-  formatter_->Format(msg, buf);
+  // 带日志点的记录使用紧凑格式, 文件名、函数名等由chunk内的日志点表还原
+  formatter::Formatter* formatter = msg.site ? compact_formatter_.get() : formatter_.get();
+  // 延迟格式化的消息先格式化出正文
+  if (msg.deferred) {
+    static thread_local std::string message;
+    msg.deferred->Format(message);
+    LogMsg formatted_msg(msg);
+    formatted_msg.message = message;
+    formatted_msg.deferred = nullptr;
+    formatter->Format(formatted_msg, buf);
+  } else {
+    // 通过Formatter序列化msg到buf中
+    formatter->Format(msg, buf);
+  }
 
-  // 如果主缓冲区空 重置压缩流
-  if (master_cache_->Empty()) {
-    compress_->ResetStream();
-    // 加入头部
-    detail::ChunkHeader chunk_header;
-    chunk_header.size = 0;//初始size
-    // copy公钥
-    memcpy(chunk_header.pub_key, client_pub_key_.data(), client_pub_key_.size());
-    // copy IV
-    memcpy(chunk_header.iv, crypt_->GetIV().data(), crypt_->GetIV().size());
-    master_cache_->Push(reinterpret_cast<char*>(&chunk_header), sizeof(chunk_header));
-  }
-  // 压缩 加密 写入master_cache_必须加锁
+  // 压缩 加密 写入缓存段必须加锁
   {
-    std::lock_guard<std::mutex> lock(mtx_);
-    // 压缩
-    //  重置压缩buf的容量为压缩后长度
-    compressed_buf_.reserve(compress_->CompressedBound(buf.size()));
-    // 压缩并得到压缩后大小
-    size_t compressed_size =
-        compress_->Compress(buf.data(), buf.size(), compressed_buf_.data(), compressed_buf_.capacity());
-
-    if (compressed_size == 0) {
-      LOG_ERROR("EffectiveSink::Log: compress failed");
+    std::unique_lock<std::mutex> lock(mtx_);
+    if (!AcquireActive_(lock, msg.level)) {
       return;
     }
-    // 加密
-    encryped_buf_.clear();
-    encryped_buf_.reserve(compressed_size + 16);  // 预留加密头部容量
-    crypt_->Encrypt(compressed_buf_.data(), compressed_size, encryped_buf_);
-    if (encryped_buf_.empty()) {
-      LOG_ERROR("EffectiveSink::Log: encrypt failed");
+    // 当前段剩余空间可能放不下这条记录(含未写入的批次和chunk索引)时切换到下一段
+    // raw模式下缓存中是原始记录, 不访问后台线程正在使用的压缩实例
+    size_t item_bound = conf_.raw_cache ? buf.size() : compress_->CompressedBound(buf.size() + batch_buf_.size());
+    size_t reserve = sizeof(detail::ChunkHeader) + 4 * (sizeof(detail::ItemHeader) + sizeof(uint32_t)) +
+                     sizeof(detail::DropMarker) + detail::ChunkIndex::kEncryptedSize + site_table_buf_.size() +
+                     item_bound + 32;
+    if (!ActiveCache_()->Empty() && (chunk_broken_ || ActiveCache_()->Available() < reserve)) {
+      RotateSegment_();
+      if (!AcquireActive_(lock, msg.level)) {
+        return;
+      }
+    }
+    // 如果当前段空 写入chunk头部
+    if (ActiveCache_()->Empty()) {
+      StartChunk_();
+    }
+    // 此前有记录被丢弃时, 在丢弃位置写入标记
+    WriteDropMarker_();
+    // 当前chunk尚未写入该日志点时, 先补写新注册的日志点
+    if (msg.site && msg.site->id > sites_written_) {
+      uint32_t site_count = LogSiteRegistry::Instance().Size();
+      site_table_buf_.clear();
+      formatter::CompactFormatter::FormatSiteTable(sites_written_, site_count, site_table_buf_);
+      if (!AppendItem_(site_table_buf_, detail::ItemHeader::kSiteTableMagic)) {
+        return;
+      }
+      sites_written_ = site_count;
+    }
+    if (!AppendItem_(buf, msg.site ? detail::ItemHeader::kSiteRecordMagic : detail::ItemHeader::kMagic)) {
       return;
     }
-    // 写入主缓冲区
-    WriteToCache_(encryped_buf_.data(), encryped_buf_.size());
+    segments_[active_]->index.Add(
+        std::chrono::duration_cast<std::chrono::microseconds>(msg.time.time_since_epoch()).count(), msg.level);
+    // Fatal记录(含同一批次中之前的记录)同步写入缓存文件
+    if (conf_.durability >= Durability::kFatalSync && msg.level >= LogLevel::kFatal) {
+      FlushBatch_();
+      ActiveCache_()->Sync();
+    }
+  }
+  CheckCacheToFile_();
+}
+EffectiveSink::AsyncRing* EffectiveSink::GetThreadRing_() {
+  // 线程退出时标记环形缓冲区已退役, 由消费者在其清空后回收
+  struct RingHolder {
+    std::shared_ptr<AsyncRing> ring;
+    ~RingHolder() {
+      if (ring) {
+        ring->retired.store(true);
+      }
+    }
+  };
+  static thread_local std::unordered_map<uint64_t, RingHolder> thread_rings;
+
+  auto iter = thread_rings.find(sink_id_);
+  if (iter != thread_rings.end()) {
+    return iter->second.ring.get();
+  }
+  auto ring = std::make_shared<AsyncRing>(space_cast<bytes>(conf_.ring_size).count());
+  {
+    std::lock_guard<std::mutex> lock(rings_mtx_);
+    rings_.push_back(ring);
   }
-  // 判断缓冲区利用率是否超过80%,超过写入日志文件
-  if (NeedCacheToFile_()) {
-    // 判断从缓冲区是否空闲
-    if (is_slave_free_.load()) {  // 原子变量，如果slave_cache_是空的，才能交换
-      is_slave_free_.store(false);
-      SwapCache_();
+  thread_rings[sink_id_].ring = ring;
+  return ring.get();
+}
+
+bool EffectiveSink::PushToRing_(const LogMsg& msg) {
+  AsyncRing* ring = GetThreadRing_();
+
+  detail::AsyncRecordHeader header;
+  header.level = static_cast<int32_t>(msg.level);
+  header.line = msg.location.line;
+  header.site = msg.site;
+  // 日志点已静态保存位置信息, 不必拷贝文件名和函数名
+  header.file_len = msg.site ? 0 : static_cast<uint32_t>(msg.location.file_name.size());
+  header.func_len = msg.site ? 0 : static_cast<uint32_t>(msg.location.func_name.size());
+  header.thread_id = msg.thread_id;
+  header.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(msg.time.time_since_epoch()).count();
+  // 延迟格式化只拷贝参数编码, 格式串保存指针
+  StringView message = msg.message;
+  if (msg.deferred) {
+    message = msg.deferred->data;
+    header.fmt = msg.deferred->fmt.data();
+    header.fmt_len = static_cast<uint32_t>(msg.deferred->fmt.size());
+    header.format_fn = msg.deferred->format_fn;
+  } else {
+    header.fmt = nullptr;
+    header.fmt_len = 0;
+    header.format_fn = nullptr;
+  }
+  header.msg_len = static_cast<uint32_t>(message.size());
+
+  size_t total = sizeof(header) + header.file_len + header.func_len + header.msg_len;
+  if (total > ring->buffer.Capacity()) {
+    return false;
+  }
+  // 缓冲区满时唤醒消费者并让出CPU, 直到有足够空间; 按溢出策略可丢弃的记录直接丢弃
+  while (!ring->buffer.TryReserve(total)) {
+    if (ShouldDrop_(msg.level)) {
+      return true;
     }
-    // 写入日志文件
-    PrepareToFile_();
+    ScheduleDrain_();
+    std::this_thread::yield();
+  }
+  ring->buffer.Write(&header, sizeof(header));
+  ring->buffer.Write(msg.location.file_name.data(), header.file_len);
+  ring->buffer.Write(msg.location.func_name.data(), header.func_len);
+  ring->buffer.Write(message.data(), header.msg_len);
+  ring->pushed.store(ring->pushed.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  ring->buffer.Commit();
+
+  ScheduleDrain_();
+  return true;
+}
+
+void EffectiveSink::ScheduleDrain_() {
+  // 已有待执行的消费任务时不再重复投递
+  if (drain_scheduled_.load() || drain_scheduled_.exchange(true)) {
+    return;
   }
+  POST_TASK(task_runner_, [this]() { DrainRings_(); });
 }
+
+void EffectiveSink::DrainRings_() {
+  // 先清除标记再消费, 保证之后写入的记录一定会触发新的消费任务
+  drain_scheduled_.store(false);
+
+  std::vector<std::shared_ptr<AsyncRing>> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mtx_);
+    rings = rings_;
+  }
+
+  std::string payload;
+  std::string formatted;
+  for (auto& ring : rings) {
+    auto& buffer = ring->buffer;
+    while (buffer.Readable() >= sizeof(detail::AsyncRecordHeader)) {
+      detail::AsyncRecordHeader header;
+      buffer.Read(&header, sizeof(header));
+      payload.resize(header.file_len + header.func_len + header.msg_len);
+      buffer.Read(payload.data(), payload.size());
+
+      StringView file_name(payload.data(), header.file_len);
+      StringView func_name(payload.data() + header.file_len, header.func_len);
+      StringView message(payload.data() + header.file_len + header.func_len, header.msg_len);
+      if (header.format_fn) {
+        header.format_fn(StringView(header.fmt, header.fmt_len), message.data(), formatted);
+        message = formatted;
+      }
+      SourceLocation location;
+      if (header.site) {
+        location = header.site->location;
+      } else {
+        location.file_name = file_name;
+        location.line = header.line;
+        location.func_name = func_name;
+      }
+      std::chrono::system_clock::time_point time{std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          std::chrono::nanoseconds(header.timestamp))};
+      LogMsg msg(location, static_cast<LogLevel>(header.level), message, time, header.thread_id);
+      msg.site = header.site;
+
+      LogSync_(msg);
+      buffer.Release();
+      ring->popped.store(ring->popped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+  }
+
+  // 回收生产者线程已退出且已清空的环形缓冲区
+  std::lock_guard<std::mutex> lock(rings_mtx_);
+  rings_.erase(std::remove_if(rings_.begin(), rings_.end(),
+                              [](const std::shared_ptr<AsyncRing>& ring) {
+                                return ring->retired.load() && ring->buffer.Readable() == 0;
+                              }),
+               rings_.end());
+}
+
+EffectiveSink::Metrics EffectiveSink::GetMetrics() {
+  Metrics metrics;
+  std::lock_guard<std::mutex> lock(rings_mtx_);
+  metrics.ring_count = rings_.size();
+  metrics.compress_level = compress_level_.load(std::memory_order_relaxed);
+  metrics.full_segments = full_segments_.load(std::memory_order_relaxed);
+  metrics.dropped = dropped_.load(std::memory_order_relaxed);
+  metrics.dropped_low_level = dropped_low_level_.load(std::memory_order_relaxed);
+  metrics.overwritten = overwritten_.load(std::memory_order_relaxed);
+  metrics.flush_ratio = conf_.flush_ratio;
+  metrics.max_flush_latency = conf_.max_flush_latency;
+  metrics.ratio_flushes = ratio_flushes_.load(std::memory_order_relaxed);
+  metrics.timed_flushes = timed_flushes_.load(std::memory_order_relaxed);
+  metrics.cold_files = cold_files_.load(std::memory_order_relaxed);
+  metrics.cold_saved_bytes = cold_saved_bytes_.load(std::memory_order_relaxed);
+  for (auto& ring : rings_) {
+    metrics.queue_depth += ring->pushed.load(std::memory_order_relaxed) - ring->popped.load(std::memory_order_relaxed);
+    metrics.queue_bytes += ring->buffer.Size();
+  }
+  return metrics;
+}
+
 void EffectiveSink::SetFormatter(std::unique_ptr<formatter::Formatter> formatter) {}
 
 void EffectiveSink::Flush() {
-  // 主从都刷新
   TIMER_COUNT("Flush");
-  // 从缓冲区写入文件
-  PrepareToFile_();
+  if (segments_.empty()) {
+    return;
+  }
+  // 异步模式先处理完环形缓冲区中的记录
+  if (conf_.async) {
+    POST_TASK(task_runner_, [this]() { DrainRings_(); });
+    WAIT_TASK_IDLE(task_runner_);
+  }
+  // 当前段交给后台线程, 等待所有写满的段写入文件
+  {
+    std::unique_lock<std::mutex> lock(mtx_);
+    WaitActiveFree_(lock);
+    WriteDropMarker_();
+    if (!ActiveCache_()->Empty()) {
+      RotateSegment_();
+    }
+  }
+  POST_TASK(task_runner_, [this]() { CacheToFile_(true); });
   WAIT_TASK_IDLE(task_runner_);
+}
+
+void EffectiveSink::RecoverCaches_() {
+  // 旧版本的主从缓冲区以及段数调小后多出的段
+  auto is_stale_cache = [this](const std::string& name) {
+    if (name == "master_cache" || name == "slave_cache") {
+      return true;
+    }
+    // 只匹配cache_<n>, prefix为cache时的日志文件(cache_<时间>.log)不能当作缓存段
+    if (name.rfind("cache_", 0) != 0 || name.size() == 6 || !isdigit(static_cast<unsigned char>(name[6]))) {
+      return false;
+    }
+    char* end = nullptr;
+    uint64_t index = std::strtoull(name.c_str() + 6, &end, 10);
+    return *end == '\0' && index >= conf_.cache_segments;
+  };
+  std::vector<std::filesystem::path> stale_paths;
+  std::vector<std::unique_ptr<mmap::MMapper>> stale_caches;
+  std::vector<mmap::MMapper*> caches;
+  for (auto& segment : segments_) {
+    caches.push_back(segment->cache.get());
+  }
+  for (auto& entry : std::filesystem::directory_iterator(conf_.dir)) {
+    if (is_stale_cache(entry.path().filename().string())) {
+      stale_paths.push_back(entry.path());
+      stale_caches.push_back(std::make_unique<mmap::MMapper>(entry.path()));
+      caches.push_back(stale_caches.back().get());
+    }
+  }
+  // 崩溃可能发生在任意位置, 只恢复校验通过的完整item
+  std::vector<mmap::MMapper*> recovered;
+  for (auto cache : caches) {
+    if (cache->Empty()) {
+      continue;
+    }
+    if (RepairCache_(*cache)) {
+      recovered.push_back(cache);
+    } else {
+      cache->Clear();
+    }
+  }
+  caches.swap(recovered);
+  // 按chunk序号恢复写入顺序, 旧格式chunk没有序号排在最前
+  auto chunk_seq = [](mmap::MMapper* cache) -> uint64_t {
+    auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(cache->Data());
+    return chunk_header->magic == detail::ChunkHeader::kLegacyMagic ? 0 : chunk_header->seq;
+  };
+  std::stable_sort(caches.begin(), caches.end(),
+                   [&](mmap::MMapper* lhs, mmap::MMapper* rhs) { return chunk_seq(lhs) < chunk_seq(rhs); });
+  for (auto cache : caches) {
+    chunk_seq_ = std::max(chunk_seq_, chunk_seq(cache));
+    WriteCache_(*cache);
+    cache->Clear();
+  }
+  stale_caches.clear();
+  for (auto& path : stale_paths) {
+    std::filesystem::remove(path);
+  }
+}
 
-  // 交换主从缓冲区后，再写入文件
-  if (is_slave_free_.load()) {
-    is_slave_free_.store(false);
-    SwapCache_();
+bool EffectiveSink::RepairCache_(mmap::MMapper& cache) {
+  auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(cache.Data());
+  size_t size = cache.Size();
+  if (size < sizeof(uint64_t) || detail::ChunkHeader::HeaderSize(chunk_header->magic) == 0) {
+    LOG_ERROR("EffectiveSink::RepairCache_: invalid chunk in {}", cache.Path().string());
+    return false;
+  }
+  // 旧格式的缓存原样写出
+  if (chunk_header->magic == detail::ChunkHeader::kLegacyMagic) {
+    return size >= detail::ChunkHeader::kLegacySize;
+  }
+  if (size <= sizeof(detail::ChunkHeader)) {
+    return false;
+  }
+  // 逐个检查item, 在第一个不完整或校验不通过的item处截断
+  const char* items = reinterpret_cast<const char*>(cache.Data()) + sizeof(detail::ChunkHeader);
+  size_t committed = size - sizeof(detail::ChunkHeader);
+  bool checked = chunk_header->flags & detail::ChunkHeader::kItemCrc;
+  size_t item_header_size = detail::ItemHeader::Size(chunk_header->flags);
+  uint32_t items_crc = 0;
+  uint32_t last_magic = 0;
+  size_t offset = 0;
+  while (offset + item_header_size <= committed) {
+    auto item_header = reinterpret_cast<const detail::ItemHeader*>(items + offset);
+    if (!detail::ItemHeader::IsValidMagic(item_header->magic) ||
+        item_header->size > committed - offset - item_header_size) {
+      break;
+    }
+    if (checked) {
+      uint32_t crc;
+      memcpy(&crc, items + offset + sizeof(detail::ItemHeader), sizeof(crc));
+      if (crc != detail::ItemHeader::Checksum(*item_header, items + offset + item_header_size, item_header->size)) {
+        break;
+      }
+      items_crc = utils::Crc32c(&crc, sizeof(crc), items_crc);
+    }
+    last_magic = item_header->magic;
+    offset += item_header_size + item_header->size;
+  }
+  if (offset == 0) {
+    return false;
+  }
+  // 截断的内容可能包含GCM tag覆盖的密文, 不再校验tag
+  if (offset < committed) {
+    LOG_ERROR("EffectiveSink::RepairCache_: drop {} torn bytes in {}", committed - offset, cache.Path().string());
+    chunk_header->flags &= ~detail::ChunkHeader::kHasTag;
+  }
+  // 以实际内容修正头部: size、索引标记和chunk校验
+  chunk_header->size = offset;
+  if (last_magic == detail::ItemHeader::kChunkIndexMagic) {
+    chunk_header->flags |= detail::ChunkHeader::kHasIndex;
+  } else {
+    chunk_header->flags &= ~detail::ChunkHeader::kHasIndex;
+  }
+  if (checked) {
+    chunk_header->flags |= detail::ChunkHeader::kHasCrc;
+    chunk_header->crc = chunk_header->Checksum(items_crc);
+  }
+  cache.Resize(sizeof(detail::ChunkHeader) + offset);
+  return true;
+}
+
+bool EffectiveSink::ShouldDrop_(LogLevel level) {
+  // 环形缓冲区中的记录无法覆盖, kOverwriteOldest在环形缓冲区满时丢弃新记录
+  switch (conf_.overflow_policy) {
+    case OverflowPolicy::kDrop:
+    case OverflowPolicy::kOverwriteOldest:
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    case OverflowPolicy::kDropLowLevel:
+      if (level < conf_.drop_level) {
+        dropped_low_level_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+      }
+      return false;
+    default:
+      return false;
+  }
+}
+
+bool EffectiveSink::AcquireActive_(std::unique_lock<std::mutex>& lock, LogLevel level) {
+  // 当前段空闲时直接写入, 所有段都写满时按溢出策略处理; 返回false表示丢弃该记录
+  if (!segments_[active_]->full.load()) {
+    return true;
+  }
+  // 后台任务线程自己负责写文件, 直接写出写满的段; 调用线程由环形缓冲区满时的策略保护
+  if (std::this_thread::get_id() == runner_thread_id_) {
+    WaitActiveFree_(lock);
+    return true;
+  }
+  if (conf_.overflow_policy == OverflowPolicy::kOverwriteOldest) {
+    if (OverwriteOldest_()) {
+      return true;
+    }
+    // 最旧的段正在写文件, 只能丢弃新记录
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  if (ShouldDrop_(level)) {
+    return false;
+  }
+  WaitActiveFree_(lock);
+  return true;
+}
+
+bool EffectiveSink::OverwriteOldest_() {
+  // 所有段都写满时当前段就是最旧的段
+  auto& segment = segments_[active_];
+  if (segment->writing) {
+    return false;
+  }
+  overwritten_.fetch_add(segment->records, std::memory_order_relaxed);
+  // 被覆盖的标记所记录的丢弃数由下一个标记重新记录
+  reported_drops_.dropped -= segment->drops.dropped;
+  reported_drops_.dropped_low_level -= segment->drops.dropped_low_level;
+  reported_drops_.overwritten -= segment->drops.overwritten;
+  segment->drops = {};
+  segment->cache->Clear();
+  segment->records = 0;
+  segment->full.store(false);
+  full_segments_.fetch_sub(1);
+  write_index_ = (write_index_ + 1) % segments_.size();
+  return true;
+}
+
+void EffectiveSink::WriteDropMarker_() {
+  detail::DropMarker total{dropped_.load(), dropped_low_level_.load(), overwritten_.load()};
+  detail::DropMarker marker{total.dropped - reported_drops_.dropped,
+                            total.dropped_low_level - reported_drops_.dropped_low_level,
+                            total.overwritten - reported_drops_.overwritten};
+  // 已结束的chunk不再追加, 标记留到下一个chunk写入
+  if ((marker.dropped == 0 && marker.dropped_low_level == 0 && marker.overwritten == 0) || chunk_broken_) {
+    return;
+  }
+  if (ActiveCache_()->Empty()) {
+    StartChunk_();
+  }
+  if (!AppendItem_(std::string(reinterpret_cast<const char*>(&marker), sizeof(marker)),
+                   detail::ItemHeader::kDropMarkerMagic)) {
+    return;
+  }
+  auto& drops = segments_[active_]->drops;
+  drops.dropped += marker.dropped;
+  drops.dropped_low_level += marker.dropped_low_level;
+  drops.overwritten += marker.overwritten;
+  reported_drops_ = total;
+}
+
+void EffectiveSink::SyncCaches_() {
+  // 尚未写入文件的记录所在的缓存段落盘; 锁内只取区域, msync(MS_SYNC)在锁外进行, 不阻塞写日志的线程
+  // 期间仍在追加的部分由下一次落盘处理
+  std::vector<mmap::MMapper::Region> regions;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    for (auto& segment : segments_) {
+      if (!segment->cache->Empty()) {
+        regions.push_back(segment->cache->Committed());
+      }
+    }
+  }
+  for (auto& region : regions) {
+    mmap::MMapper::Sync(region);
+  }
+  // 已写入日志文件但还在页缓存中的记录落盘
+  if (file_writer_.IsOpen()) {
+    file_writer_.Sync();
+  }
+}
+
+void EffectiveSink::RotateSegment_() {
+  // 未压缩的批量记录属于当前chunk, 切换前写入当前段
+  FlushBatch_();
+  FinishChunk_();
+  SealChunk_();
+  // 当前段交给后台线程写入文件, 之后的记录写入下一段
+  segments_[active_]->full.store(true);
+  full_segments_.fetch_add(1);
+  active_ = (active_ + 1) % segments_.size();
+  // raw模式下iv由写文件的后台线程更新
+  if (!conf_.raw_cache && crypt_) {
+    crypt_->GenerateIV();// 更新加密的iv
   }
   PrepareToFile_();
-  WAIT_TASK_IDLE(task_runner_);
 }
 
-void EffectiveSink::SwapCache_() {
+void EffectiveSink::WaitActiveFree_(std::unique_lock<std::mutex>& lock) {
+  // 所有段都已写满时等待后台线程写完文件; 在后台线程上(异步模式)直接执行写文件任务
+  while (segments_[active_]->full.load()) {
+    if (std::this_thread::get_id() == runner_thread_id_) {
+      lock.unlock();
+      CacheToFile_(true);
+      lock.lock();
+    } else {
+      segment_cv_.wait(lock);
+    }
+  }
+}
+
+void EffectiveSink::StartChunk_() {
+  chunk_broken_ = false;
+  segments_[active_]->index = detail::ChunkIndex();
+  segments_[active_]->items_crc = 0;
+  // raw模式下压缩流和加密都在写文件时处理, 缓存中只记录原始item
+  if (conf_.raw_cache) {
+    detail::ChunkHeader chunk_header;
+    chunk_header.magic = detail::ChunkHeader::kRawMagic;
+    chunk_header.seq = ++chunk_seq_;
+    ActiveCache_()->Push(reinterpret_cast<char*>(&chunk_header), sizeof(chunk_header));
+    sites_written_ = 0;
+    return;
+  }
+  // 新chunk重置压缩流, 自适应的压缩级别在新帧开始时生效
+  if (conf_.adaptive_level) {
+    AdjustLevel_();
+  }
+  compress_->ResetStream();
+  // 加入头部
+  detail::ChunkHeader chunk_header;
+  chunk_header.size = 0;  // 初始size
+  // copy公钥
+  memcpy(chunk_header.pub_key, client_pub_key_.data(), client_pub_key_.size());
+  // copy IV
+  std::string iv = crypt_ ? crypt_->GetIV() : std::string();
+  memcpy(chunk_header.iv, iv.data(), iv.size());
+  chunk_header.cipher = conf_.cipher;
+  chunk_header.compress = conf_.compress;
+  chunk_header.dict_id = compress_->DictID();
+  chunk_header.flags = detail::ChunkHeader::kItemCrc;
+  if (crypt_) {
+    chunk_header.flags |= detail::ChunkHeader::kIndexEncrypted;
+  }
+  chunk_header.seq = ++chunk_seq_;
+  ActiveCache_()->Push(reinterpret_cast<char*>(&chunk_header), sizeof(chunk_header));
+  // 流式加密每个chunk初始化一次
+  if (stream_crypt_) {
+    chunk_open_ = stream_crypt_->EncryptInit(iv);
+  }
+  // 每个chunk独立携带日志点表
+  sites_written_ = 0;
+}
+
+void EffectiveSink::FinishChunk_() {
+  if (!chunk_open_) {
+    return;
+  }
+  chunk_open_ = false;
+  // GCM chunk结束时把tag写回缓存段中的chunk头部
+  auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(ActiveCache_()->Data());
+  if (stream_crypt_->EncryptFinal(chunk_header->tag) && conf_.cipher == crypt::CipherType::kAesGcm) {
+    chunk_header->flags |= detail::ChunkHeader::kHasTag;
+  }
+}
+
+void EffectiveSink::SealChunk_() {
+  // 写入索引(不经过压缩流和加密)并计算chunk校验, 之后chunk不再追加item
+  auto cache = ActiveCache_();
+  if (cache->Empty()) {
+    return;
+  }
+  auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(cache->Data());
+  if (chunk_header->flags & (detail::ChunkHeader::kHasIndex | detail::ChunkHeader::kHasCrc)) {
+    return;
+  }
+  // raw chunk的索引在缓存中不加密, 写文件时随chunk一起加密
+  bool encrypted = chunk_header->flags & detail::ChunkHeader::kIndexEncrypted;
+  std::string index = segments_[active_]->index.Encode(encrypted ? shared_secret_ : std::string());
+  size_t size = cache->Size();
+  if (!index.empty()) {
+    WriteToCache_(index.data(), index.size(), detail::ItemHeader::kChunkIndexMagic);
+  }
+  chunk_header = reinterpret_cast<detail::ChunkHeader*>(cache->Data());
+  detail::ChunkHeader sealed = *chunk_header;
+  if (cache->Size() > size) {
+    sealed.flags |= detail::ChunkHeader::kHasIndex;
+  }
+  // raw chunk写文件时重新生成头部和校验
+  if (sealed.flags & detail::ChunkHeader::kItemCrc) {
+    sealed.flags |= detail::ChunkHeader::kHasCrc;
+    sealed.crc = sealed.Checksum(segments_[active_]->items_crc);
+  }
+  // 先写校验再置标记, 崩溃在两者之间时恢复会重新计算
+  chunk_header->crc = sealed.crc;
+  std::atomic_thread_fence(std::memory_order_release);
+  chunk_header->flags = sealed.flags;
+}
+
+bool EffectiveSink::AppendItem_(const std::string& data, uint32_t magic) {
+  if (magic == detail::ItemHeader::kMagic || magic == detail::ItemHeader::kSiteRecordMagic) {
+    ++segments_[active_]->records;
+  }
+  // raw模式: 序列化后的记录直接拷贝进缓存, 没有流状态, 写入失败只丢弃该记录
+  if (conf_.raw_cache) {
+    if (!WriteToCache_(data.data(), data.size(), magic)) {
+      if (magic == detail::ItemHeader::kMagic || magic == detail::ItemHeader::kSiteRecordMagic) {
+        --segments_[active_]->records;
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+      }
+      return false;
+    }
+    return true;
+  }
+  if (conf_.batch_size.count() == 0) {
+    return WriteItem_(data, magic);
+  }
+  // 批量模式: 以未压缩的item格式追加到批量缓冲区, 攒够后整体压缩加密
+  detail::ItemHeader item_header;
+  item_header.magic = magic;
+  item_header.size = static_cast<uint32_t>(data.size());
+  batch_buf_.append(reinterpret_cast<const char*>(&item_header), sizeof(item_header));
+  batch_buf_.append(data);
+  if (batch_buf_.size() >= space_cast<bytes>(conf_.batch_size).count()) {
+    return FlushBatch_();
+  }
+  return true;
+}
+
+bool EffectiveSink::FlushBatch_() {
+  if (batch_buf_.empty()) {
+    return true;
+  }
+  bool ret = WriteItem_(batch_buf_, detail::ItemHeader::kGroupMagic);
+  batch_buf_.clear();
+  return ret;
+}
+
+double EffectiveSink::Backlog_() const {
+  // 没有写满的段说明写文件跟得上; 否则正在写的段之外, 排队的段与当前段的填充占其余段的比例即为积压
+  size_t full = full_segments_.load();
+  if (full == 0) {
+    return 0.0;
+  }
+  return (full - 1 + ActiveCache_()->GetRatio()) / (segments_.size() - 1);
+}
+
+int EffectiveSink::TargetLevel_(double backlog_ratio) {
+  // 积压程度: 待写入数据占写文件阈值的比例, 以及task runner中排队的任务数
+  double pressure = std::max(backlog_ratio / conf_.flush_ratio, PENDING_TASK_COUNT(task_runner_) / 2.0);
+  if (pressure > 0.75) {
+    return conf_.min_level;
+  }
+  if (pressure < 0.25) {
+    return conf_.max_level;
+  }
+  return conf_.compress_level;
+}
+
+void EffectiveSink::AdjustLevel_() {
+  items_since_adjust_ = 0;
+  compress_->SetLevel(TargetLevel_(Backlog_()));
+}
+
+bool EffectiveSink::WriteItem_(const std::string& data, uint32_t magic) {
+  if (conf_.adaptive_level && ++items_since_adjust_ >= kAdjustLevelInterval) {
+    AdjustLevel_();
+  }
+  // 压缩
+  //  重置压缩buf的大小为压缩后长度上限
+  compressed_buf_.resize(compress_->CompressedBound(data.size()));
+  // 压缩并得到压缩后大小
+  size_t compressed_size =
+      compress_->Compress(data.data(), data.size(), compressed_buf_.data(), compressed_buf_.size());
+
+  if (compressed_size == 0) {
+    LOG_ERROR("EffectiveSink::Log: compress failed");
+    return false;
+  }
+  compress_level_.store(compress_->Level(), std::memory_order_relaxed);
+  // 不加密或流式加密(原地加密)时直接写入
+  const char* item = compressed_buf_.data();
+  size_t item_size = compressed_size;
+  if (stream_crypt_) {
+    if (!stream_crypt_->Encrypt(compressed_buf_.data(), compressed_size)) {
+      return false;
+    }
+  } else if (crypt_) {
+    // 加密
+    encryped_buf_.clear();
+    encryped_buf_.reserve(compressed_size + 16);  // 预留加密头部容量
+    crypt_->Encrypt(compressed_buf_.data(), compressed_size, encryped_buf_);
+    if (encryped_buf_.empty()) {
+      LOG_ERROR("EffectiveSink::Log: encrypt failed");
+      return false;
+    }
+    item = encryped_buf_.data();
+    item_size = encryped_buf_.size();
+  }
+  // 写入主缓冲区
+  if (!WriteToCache_(item, item_size, magic)) {
+    BreakChunk_(data, magic);
+    return false;
+  }
+  return true;
+}
+
+void EffectiveSink::BreakChunk_(const std::string& data, uint32_t magic) {
+  // 回滚缓存不能回滚压缩流和加密流, 之后的item无法解码; 结束当前chunk, 下一条记录从下一段的新chunk开始
+  FinishChunk_();
+  // GCM tag包含了未写入缓存的item, 不能用于校验
+  auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(ActiveCache_()->Data());
+  chunk_header->flags &= ~detail::ChunkHeader::kHasTag;
+  SealChunk_();
+  chunk_broken_ = true;
+  // 丢失的记录由下一个chunk中的丢弃标记记录
+  uint64_t records = 0;
+  if (magic == detail::ItemHeader::kMagic || magic == detail::ItemHeader::kSiteRecordMagic) {
+    records = 1;
+  } else if (magic == detail::ItemHeader::kGroupMagic) {
+    for (size_t offset = 0; offset + sizeof(detail::ItemHeader) <= data.size();) {
+      auto item_header = reinterpret_cast<const detail::ItemHeader*>(data.data() + offset);
+      if (item_header->magic == detail::ItemHeader::kMagic ||
+          item_header->magic == detail::ItemHeader::kSiteRecordMagic) {
+        ++records;
+      }
+      offset += sizeof(detail::ItemHeader) + item_header->size;
+    }
+  }
+  segments_[active_]->records -= records;
+  dropped_.fetch_add(records, std::memory_order_relaxed);
+}
+
+void EffectiveSink::CheckCacheToFile_() {
   std::lock_guard<std::mutex> lock(mtx_);
-  // 交换主从缓冲区指针
-  std::swap(master_cache_, slave_cache_);
-  crypt_->GenerateIV();// 更新加密的iv
+  // 当前段利用率超过flush_ratio且下一段空闲时切换, 下一段未空闲时继续使用当前段的剩余空间
+  size_t next = (active_ + 1) % segments_.size();
+  if (ActiveCache_()->GetRatio() > conf_.flush_ratio && !segments_[next]->full.load()) {
+    RotateSegment_();
+    ratio_flushes_.fetch_add(1, std::memory_order_relaxed);
+  }
 }
 
-bool EffectiveSink::NeedCacheToFile_() {
-  // 返回主缓冲区实际内容与mmap空间所占比率是否超过80%
-  return master_cache_->GetRatio() > 0.8;
+void EffectiveSink::TimedFlush_() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  // 下一段还在等待写文件时不切换, 避免阻塞调用线程; 写文件跟上后由下一次检查切换
+  size_t next = (active_ + 1) % segments_.size();
+  if (ActiveCache_()->Empty() || segments_[active_]->full.load() || segments_[next]->full.load()) {
+    return;
+  }
+  RotateSegment_();
+  timed_flushes_.fetch_add(1, std::memory_order_relaxed);
 }
 
-void EffectiveSink::WriteToCache_(const void* data, uint32_t size) {
+bool EffectiveSink::WriteToCache_(const void* data, uint32_t size, uint32_t magic) {
+  auto cache = ActiveCache_();
   // 缓存头部,保存数据size
   detail::ItemHeader item_header;
+  item_header.magic = magic;
   item_header.size = size;
-  master_cache_->Push(&item_header, sizeof(item_header));
-  master_cache_->Push(data, size);
-  // 设置chunk size
-  reinterpret_cast<detail::ChunkHeader*>(master_cache_->Data())->size += (size+sizeof(item_header));
+  bool checked = reinterpret_cast<detail::ChunkHeader*>(cache->Data())->flags & detail::ChunkHeader::kItemCrc;
+  // 头部之后写入item校验
+  uint32_t crc = checked ? detail::ItemHeader::Checksum(item_header, data, size) : 0;
+  if (!cache->Stage(&item_header, sizeof(item_header)) || (checked && !cache->Stage(&crc, sizeof(crc))) ||
+      !cache->Stage(data, size)) {
+    cache->Rollback();
+    LOG_ERROR("EffectiveSink::WriteToCache_: cache segment is full, item size {}", size);
+    return false;
+  }
+  // 先更新chunk size再提交缓存size, 恢复时以缓存size为准
+  auto chunk_header = reinterpret_cast<detail::ChunkHeader*>(cache->Data());
+  chunk_header->size += cache->Staged();
+  cache->Commit();
+  if (checked) {
+    segments_[active_]->items_crc = utils::Crc32c(&crc, sizeof(crc), segments_[active_]->items_crc);
+  }
+  return true;
 }
 
 void EffectiveSink::PrepareToFile_() {
@@ -159,94 +959,392 @@ void EffectiveSink::PrepareToFile_() {
   POST_TASK(task_runner_, [this]() {  CacheToFile_();});
 }
 
-void EffectiveSink::CacheToFile_() {
+void EffectiveSink::CacheToFile_(bool wait) {
   TIMER_COUNT("CacheToFile_");
-  // 从缓冲区空则返回
-  if (is_slave_free_.load()) {
+  if (file_writer_.IsAsync()) {
+    // 提交所有写满的段, 每完成一个写入就检查是否有其他任务, 有则稍后再回收, 不阻塞后台线程
+    SubmitCaches_();
+    ReapCaches_(false);
+    while (file_writer_.PendingWrites() > 0) {
+      if (!wait && !closing_.load() && PENDING_TASK_COUNT(task_runner_) > 0) {
+        PrepareToFile_();
+        return;
+      }
+      ReapCaches_(true);
+      SubmitCaches_();
+    }
     return;
   }
-  if (slave_cache_->Empty()) {
-    is_slave_free_.store(true);
-    return;
+  // 按切换顺序写出所有写满的段
+  while (true) {
+    size_t index = 0;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      index = write_index_;
+      if (!segments_[index]->full.load()) {
+        break;
+      }
+      // 写文件期间该段不能被kOverwriteOldest覆盖
+      segments_[index]->writing = true;
+    }
+    bool written = WriteCache_(*segments_[index]->cache);
+    ReleaseSegment_(index, !written);
   }
-  // 从cache内容转移到日志文件中
+}
+
+void EffectiveSink::SubmitCaches_() {
+  // 从write_index_开始按顺序提交写满且尚未提交的段, 写完前保持writing状态不被覆盖
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    size_t index = 0;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      index = (write_index_ + i) % segments_.size();
+      if (!segments_[index]->full.load()) {
+        break;
+      }
+      if (segments_[index]->writing) {
+        continue;
+      }
+      segments_[index]->writing = true;
+      RegisterCaches_();
+    }
+    CacheSegment* segment = segments_[index].get();
+    auto& cache = *segment->cache;
+    bool submitted = false;
+    bool encoded = true;
+    if (!cache.Empty() && OpenLogFile_()) {
+      auto data = reinterpret_cast<char*>(cache.Data());
+      bool sync = conf_.durability >= Durability::kFileSync;
+      // raw chunk压缩加密到段自己的缓冲区, 写完前不会被下一段覆盖
+      if (reinterpret_cast<detail::ChunkHeader*>(data)->magic == detail::ChunkHeader::kRawMagic) {
+        encoded = EncodeRawChunk_(data, cache.Size(), segment->encoded);
+        submitted = encoded && file_writer_.WriteAsync(segment->encoded.data(), segment->encoded.size(), sync, index);
+      } else {
+        submitted = file_writer_.WriteAsync(data, cache.Size(), sync, index);
+      }
+    }
+    // 空段以及无法写入的段与同步写文件时一样直接清空, 先等之前提交的段写完以保持释放顺序
+    if (!submitted) {
+      while (file_writer_.PendingWrites() > 0) {
+        ReapCaches_(true);
+      }
+      ReleaseSegment_(index, !encoded);
+    }
+  }
+}
+
+void EffectiveSink::ReapCaches_(bool wait) {
+  std::vector<uint64_t> tokens;
+  file_writer_.Reap(tokens, wait);
+  for (auto index : tokens) {
+    ReleaseSegment_(index);
+  }
+}
+
+void EffectiveSink::ReleaseSegment_(size_t index, bool lost) {
+  // 清空写完文件的段, 设置为空闲并唤醒等待空闲段的线程
   {
-    auto file_path = GetFilePath_();
-    // 写入头部和数据通过文件追加模式
-    std::ofstream ofs(file_path, std::ios::binary | std::ios::app);
-    ofs.write(reinterpret_cast<char*>(slave_cache_->Data()), slave_cache_->Size());
-    ofs.close();
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto& segment = segments_[index];
+    // 丢失的记录以及段中丢弃标记所记录的丢弃数由下一个标记重新记录
+    if (lost) {
+      dropped_.fetch_add(segment->records, std::memory_order_relaxed);
+      reported_drops_.dropped -= segment->drops.dropped;
+      reported_drops_.dropped_low_level -= segment->drops.dropped_low_level;
+      reported_drops_.overwritten -= segment->drops.overwritten;
+    }
+    segment->cache->Clear();
+    segment->records = 0;
+    segment->drops = {};
+    segment->writing = false;
+    segment->full.store(false);
+    full_segments_.fetch_sub(1);
+    write_index_ = (index + 1) % segments_.size();
   }
-  // 清空从缓冲区,设置从缓冲区空闲
-  slave_cache_->Clear();
-  is_slave_free_.store(true);
+  segment_cv_.notify_all();
 }
 
-std::filesystem::path EffectiveSink::GetFilePath_() {
-  // 文件名格式：{prefix}_{datetime}.log 或 {prefix}_{datetime}_{index}.log
-  auto GetDateTimePath = [this]() -> std::filesystem::path {
-    std::time_t now = std::time(nullptr);
-    std::tm tm;
-    utils::LocalTime(&tm, &now);
-    char time_buf[32] = {0};
-    std::strftime(time_buf, sizeof(time_buf), "%Y%m%d%H%M%S", &tm);
-    return (conf_.dir / (conf_.prefix + "_" + time_buf));
-  };
+void EffectiveSink::RegisterCaches_() {
+  // 缓存段扩容后映射地址改变, 需重新注册; 注册失败(如缓存目录不在tmpfs上)时映射不变就不再重试
+  std::vector<filesystem::FileWriter::Buffer> buffers;
+  for (auto& segment : segments_) {
+    auto& cache = segment->cache;
+    buffers.push_back({cache->Data(), cache->Size() + cache->Available()});
+  }
+  bool changed = buffers.size() != registered_caches_.size();
+  for (size_t i = 0; !changed && i < buffers.size(); ++i) {
+    changed = buffers[i].data != registered_caches_[i].data || buffers[i].size != registered_caches_[i].size;
+  }
+  if (changed) {
+    file_writer_.RegisterBuffers(buffers);
+    registered_caches_ = std::move(buffers);
+  }
+}
 
-  if (log_file_path_.empty()) {
-    // 文件路径为空 直接赋值
-    log_file_path_ = GetDateTimePath().string() + ".log";
+bool EffectiveSink::WriteCache_(mmap::MMapper& cache) {
+  if (cache.Empty()) {
+    return true;
+  }
+  // 从cache内容转移到日志文件中
+  if (!OpenLogFile_()) {
+    return true;
+  }
+  auto data = reinterpret_cast<char*>(cache.Data());
+  auto size = cache.Size();
+  // raw chunk在此压缩加密, 已处理过的chunk(如关闭raw模式前遗留的缓存)原样写入
+  if (reinterpret_cast<detail::ChunkHeader*>(data)->magic == detail::ChunkHeader::kRawMagic) {
+    if (!EncodeRawChunk_(data, size, file_chunk_buf_)) {
+      return false;
+    }
+    file_writer_.Write(file_chunk_buf_.data(), file_chunk_buf_.size());
   } else {
-    // 获取文件大小
-    auto file_size = filesystem::GetFileSize(log_file_path_);
-    bytes single_bytes = space_cast<bytes>(conf_.single_size);
-    // 文件大小超过单个文件最大值 创建新文件 否则继续用之前log_file_path_
-    if (file_size > single_bytes.count()) {
-      std::string date_time_path = GetDateTimePath().string();
-      std::string file_path = date_time_path + ".log";
-      // 同名文件 加索引号区分
-      if (std::filesystem::exists(file_path)) {
-        int idx = 0;
-        // 寻找同名文件个数
-        for (auto& path : std::filesystem::directory_iterator(conf_.dir)) {
-          if (path.path().filename().string().find(date_time_path) != std::string::npos) {
-            ++idx;
-          }
-        }
-        log_file_path_ = date_time_path + "_" + std::to_string(idx) + ".log";
-      } else {
-        log_file_path_ = std::move(file_path);
-      }
+    // 缓存段本身就是文件, 映射内容已在页缓存中, 由内核直接拷贝到日志文件
+    file_writer_.CopyFrom(cache.FileHandle(), mmap::MMapper::DataOffset(), data, size);
+  }
+  if (conf_.durability >= Durability::kFileSync) {
+    file_writer_.Sync();
+  }
+  return true;
+}
+
+bool EffectiveSink::EncodeRawChunk_(const char* data, size_t size, std::string& dest) {
+  TIMER_COUNT("EncodeRawChunk_");
+  dest.clear();
+  auto raw_header = reinterpret_cast<const detail::ChunkHeader*>(data);
+  // 缓存中的item序列即group item的解压结果, 整体压缩加密为一个group item
+  const char* items = data + sizeof(detail::ChunkHeader);
+  size_t items_size = std::min<size_t>(raw_header->size, size - sizeof(detail::ChunkHeader));
+  // 索引(缓存中为明文)放在压缩后的group item之后, 加密的chunk中同样加密
+  detail::ChunkIndex index;
+  bool indexed = detail::ChunkIndex::Find(raw_header->flags, items, items_size, std::string(), index);
+  if (indexed) {
+    items_size -= detail::ChunkIndex::ItemSize(raw_header->flags);
+  }
+  if (items_size == 0) {
+    return false;
+  }
+  if (conf_.adaptive_level) {
+    double backlog_ratio = 0;
+    {
+      std::lock_guard<std::mutex> lock(mtx_);
+      backlog_ratio = Backlog_();
     }
+    file_compress_->SetLevel(TargetLevel_(backlog_ratio));
+  }
+  file_compress_->ResetStream();
+  file_compressed_buf_.resize(file_compress_->CompressedBound(items_size));
+  size_t compressed_size =
+      file_compress_->Compress(items, items_size, file_compressed_buf_.data(), file_compressed_buf_.size());
+  if (compressed_size == 0) {
+    LOG_ERROR("EffectiveSink::EncodeRawChunk_: compress failed");
+    return false;
   }
-  // LOG_INFO("EffectiveSink::GetFilePath_: log_file_path={}", log_file_path_.string());
-  return log_file_path_;
+  compress_level_.store(file_compress_->Level(), std::memory_order_relaxed);
+  // 每个chunk使用新的iv
+  std::string iv = crypt_ ? crypt_->GenerateIV() : std::string();
+  detail::ChunkHeader chunk_header;
+  memcpy(chunk_header.pub_key, client_pub_key_.data(), client_pub_key_.size());
+  memcpy(chunk_header.iv, iv.data(), iv.size());
+  chunk_header.cipher = conf_.cipher;
+  chunk_header.compress = conf_.compress;
+  chunk_header.dict_id = file_compress_->DictID();
+  chunk_header.flags = detail::ChunkHeader::kItemCrc | detail::ChunkHeader::kHasCrc;
+  StringView encrypted;
+  std::string cbc_encrypted;
+  if (!crypt_) {
+    encrypted = StringView(file_compressed_buf_.data(), compressed_size);
+  } else if (stream_crypt_) {
+    // chunk只有一个item, 加密后立即生成tag
+    if (!stream_crypt_->EncryptInit(iv) || !stream_crypt_->Encrypt(file_compressed_buf_.data(), compressed_size) ||
+        !stream_crypt_->EncryptFinal(chunk_header.tag)) {
+      LOG_ERROR("EffectiveSink::EncodeRawChunk_: encrypt failed");
+      return false;
+    }
+    if (conf_.cipher == crypt::CipherType::kAesGcm) {
+      chunk_header.flags |= detail::ChunkHeader::kHasTag;
+    }
+    encrypted = StringView(file_compressed_buf_.data(), compressed_size);
+  } else {
+    crypt_->Encrypt(file_compressed_buf_.data(), compressed_size, cbc_encrypted);
+    if (cbc_encrypted.empty()) {
+      LOG_ERROR("EffectiveSink::EncodeRawChunk_: encrypt failed");
+      return false;
+    }
+    encrypted = cbc_encrypted;
+  }
+
+  // 头部在item之后填写大小和校验
+  dest.append(reinterpret_cast<const char*>(&chunk_header), sizeof(chunk_header));
+  uint32_t crc =
+      detail::ItemHeader::AppendChecked(dest, detail::ItemHeader::kGroupMagic, encrypted.data(), encrypted.size());
+  uint32_t items_crc = utils::Crc32c(&crc, sizeof(crc));
+  std::string index_payload = indexed ? index.Encode(crypt_ ? shared_secret_ : std::string()) : std::string();
+  if (!index_payload.empty()) {
+    chunk_header.flags |= detail::ChunkHeader::kHasIndex;
+    if (crypt_) {
+      chunk_header.flags |= detail::ChunkHeader::kIndexEncrypted;
+    }
+    crc = detail::ItemHeader::AppendChecked(dest, detail::ItemHeader::kChunkIndexMagic, index_payload.data(),
+                                            index_payload.size());
+    items_crc = utils::Crc32c(&crc, sizeof(crc), items_crc);
+  }
+  chunk_header.size = dest.size() - sizeof(chunk_header);
+  chunk_header.crc = chunk_header.Checksum(items_crc);
+  memcpy(dest.data(), &chunk_header, sizeof(chunk_header));
+  return true;
 }
 
-void EffectiveSink::ElimateFiles_() {
-  LOG_INFO("EffectiveSink::ElimateFiles_: start");
-  // 将目录下所有日志文件存入files数组
-  std::vector<std::filesystem::path> files;
-  for (auto& path : std::filesystem::directory_iterator(conf_.dir)) {
-    if (path.path().extension() == ".log") {
-      files.push_back(path.path());
+void EffectiveSink::ScanLogFiles_() {
+  // 启动时扫描一次目录, 重建日志文件索引和轮转状态, 之后轮转和淘汰只依据内存中的状态
+  std::string prefix = conf_.prefix + "_";
+  std::vector<std::filesystem::path> stale_cold_paths;
+  for (auto& entry : std::filesystem::directory_iterator(conf_.dir)) {
+    // 冷归档未完成时进程退出遗留的临时文件
+    if (entry.path().extension() == ".cold") {
+      stale_cold_paths.push_back(entry.path());
+      continue;
+    }
+    if (entry.path().extension() != ".log") {
+      continue;
+    }
+    std::error_code ec;
+    auto last_write = std::chrono::system_clock::now();
+    auto file_time = entry.last_write_time(ec);
+    if (!ec) {
+      // C++17没有file_clock到system_clock的转换, 按两个时钟当前时间的差值换算
+      last_write += std::chrono::duration_cast<std::chrono::system_clock::duration>(
+          file_time - std::filesystem::file_time_type::clock::now());
+    }
+    size_t size = entry.file_size(ec);
+    log_files_.push_back({entry.path(), ec ? 0 : size, last_write, last_write});
+    log_files_bytes_ += log_files_.back().size;
+    // {prefix}_{datetime}.log 或 {prefix}_{datetime}_{index}.log
+    std::string stem = entry.path().stem().string();
+    if (stem.rfind(prefix, 0) != 0 || stem.size() < prefix.size() + 14) {
+      continue;
+    }
+    std::string time = stem.substr(prefix.size(), 14);
+    int index = -1;
+    if (stem.size() > prefix.size() + 15 && stem[prefix.size() + 14] == '_') {
+      index = std::atoi(stem.c_str() + prefix.size() + 15);
+    }
+    if (time > file_time_ || (time == file_time_ && index > file_index_)) {
+      file_time_ = time;
+      file_index_ = index;
     }
   }
-  // 根据文件最后写入时间倒序排序
-  std::sort(files.begin(), files.end(), [](const std::filesystem::path& lhs, const std::filesystem::path& rhs) {
-    return std::filesystem::last_write_time(lhs) > std::filesystem::last_write_time(rhs);
+  std::sort(log_files_.begin(), log_files_.end(), [](const LogFile& lhs, const LogFile& rhs) {
+    return lhs.end != rhs.end ? lhs.end < rhs.end : lhs.path < rhs.path;
   });
+  for (auto& path : stale_cold_paths) {
+    std::error_code ec;
+    std::filesystem::remove(path, ec);
+  }
+}
 
-  // 超过总文件最大size 淘汰日期早的日志文件
+bool EffectiveSink::OpenLogFile_() {
+  size_t single_bytes = space_cast<bytes>(conf_.single_size).count();
+  // 文件大小(内存中记录)未超过单个文件最大值时继续使用当前文件
+  if (file_writer_.IsOpen() && file_writer_.Size() <= single_bytes) {
+    return true;
+  }
+  // 切换文件前旧文件落盘, 周期落盘只处理当前文件
+  if (file_writer_.IsOpen() && conf_.durability == Durability::kPeriodic) {
+    file_writer_.Sync();
+  }
+  // 文件名格式：{prefix}_{datetime}.log 或 {prefix}_{datetime}_{index}.log
+  // 同一秒内(或时钟回拨后)的新文件沿用最新文件的时间并递增索引号, 文件名保持递增且不会重名
+  std::time_t now = std::time(nullptr);
+  std::tm tm;
+  utils::LocalTime(&tm, &now);
+  char time_buf[32] = {0};
+  std::strftime(time_buf, sizeof(time_buf), "%Y%m%d%H%M%S", &tm);
+  if (time_buf > file_time_) {
+    file_time_ = time_buf;
+    file_index_ = -1;
+  } else {
+    ++file_index_;
+  }
+  std::string file_name = conf_.prefix + "_" + file_time_;
+  if (file_index_ >= 0) {
+    file_name += "_" + std::to_string(file_index_);
+  }
+  // 关闭旧文件时截断掉未使用的预分配空间, 关闭的文件加入索引并检查淘汰
+  auto now_time = std::chrono::system_clock::now();
+  if (file_writer_.IsOpen()) {
+    std::filesystem::path closed_path = file_writer_.Path();
+    log_files_.push_back({closed_path, file_writer_.Size(), file_begin_, now_time});
+    log_files_bytes_ += file_writer_.Size();
+    file_writer_.Close();
+    ElimateFiles_();
+    if (cold_archiver_) {
+      ArchiveFile_(closed_path);
+    }
+  }
+  file_begin_ = now_time;
+  return file_writer_.Open(conf_.dir / (file_name + ".log"), single_bytes);
+}
+
+void EffectiveSink::ElimateFiles_() {
+  // 日志文件总大小(含当前文件)超过上限时, 从最早的文件开始淘汰, 当前文件不淘汰
   size_t total_bytes = space_cast<bytes>(conf_.total_size).count();
-  size_t used_bytes = 0;
-  for (auto& file : files) {
-    used_bytes += filesystem::GetFileSize(file);
-    if (used_bytes > total_bytes) {
-      LOG_INFO("EffectiveSink::ElimateFiles_: remove file={}", file.string());
-      std::filesystem::remove(file);
+  size_t current_bytes = file_writer_.IsOpen() ? file_writer_.Size() : 0;
+  while (!log_files_.empty() && log_files_bytes_ + current_bytes > total_bytes) {
+    LOG_INFO("EffectiveSink::ElimateFiles_: remove file={}", log_files_.front().path.string());
+    std::error_code ec;
+    std::filesystem::remove(log_files_.front().path, ec);
+    log_files_bytes_ -= log_files_.front().size;
+    log_files_.pop_front();
+  }
+}
+
+void EffectiveSink::ArchiveFile_(const std::filesystem::path& path) {
+  // 析构开始后不再投递, 已投递的任务也直接跳过
+  if (closing_.load()) {
+    return;
+  }
+  auto archive_task = [this, path]() {
+    if (closing_.load()) {
+      return;
     }
+    std::filesystem::path cold_path = path;
+    cold_path += ".cold";
+    size_t size = cold_archiver_->Archive(path, cold_path, closing_);
+    if (size == 0) {
+      std::error_code ec;
+      std::filesystem::remove(cold_path, ec);
+      return;
+    }
+    // 文件索引只在任务线程中访问, 由任务线程替换原文件
+    auto commit_task = [this, path, cold_path, size]() { CommitColdFile_(path, cold_path, size); };
+    POST_TASK(task_runner_, commit_task);
+  };
+  POST_TASK(cold_runner_, archive_task);
+}
+
+void EffectiveSink::CommitColdFile_(const std::filesystem::path& path,
+                                    const std::filesystem::path& cold_path,
+                                    size_t size) {
+  std::error_code ec;
+  // 归档期间原文件可能已被淘汰, 此时丢弃归档结果
+  auto it = std::find_if(log_files_.rbegin(), log_files_.rend(),
+                         [&path](const LogFile& log_file) { return log_file.path == path; });
+  if (it == log_files_.rend()) {
+    std::filesystem::remove(cold_path, ec);
+    return;
+  }
+  std::filesystem::rename(cold_path, path, ec);
+  if (ec) {
+    LOG_ERROR("EffectiveSink::CommitColdFile_: rename {} failed, {}", cold_path.string(), ec.message());
+    std::filesystem::remove(cold_path, ec);
+    return;
+  }
+  cold_files_.fetch_add(1, std::memory_order_relaxed);
+  if (it->size > size) {
+    cold_saved_bytes_.fetch_add(it->size - size, std::memory_order_relaxed);
   }
+  log_files_bytes_ = log_files_bytes_ - it->size + size;
+  it->size = size;
 }
 
 }  // namespace sink
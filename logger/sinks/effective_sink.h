@@ -1,43 +1,265 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include "compress/compress.h"
 #include "context/context.h"
+#include "context/ring_buffer.h"
 #include "crypt/aes_crypt.h"
+#include "crypt/aes_stream_crypt.h"
 #include "mmap/mmapper.h"
 #include "sinks/sink.h"
 #include "space.h"
+#include "utils/crc32c.h"
+#include "utils/file_writer.h"
 
 namespace logger {
 
 namespace detail {
 struct ChunkHeader {
-  static constexpr uint64_t kMagic = 0xdeadbeefdada1100;
+  static constexpr uint64_t kLegacyMagic = 0xdeadbeefdada1100;  // 旧格式: 只有magic到iv的字段, 逐条CBC加密
+  static constexpr uint64_t kMagic = 0xdeadbeefdada1101;
+  static constexpr uint64_t kRawMagic = 0xdeadbeefdada1110;  // 未压缩未加密的chunk, 只存在于mmap缓存中
+  static constexpr size_t kLegacySize = 160;
+  static constexpr uint16_t kHasTag = 0x1;  // tag有效(GCM chunk已正常结束)
+  static constexpr uint16_t kCold = 0x2;    // 冷归档时由多个chunk的记录重新压缩而成
+  static constexpr uint16_t kHasIndex = 0x4;  // 最后一个item为明文的ChunkIndex
+  static constexpr uint16_t kItemCrc = 0x8;   // 每个item头部之后有4字节的CRC32C
+  static constexpr uint16_t kHasCrc = 0x10;   // crc有效(chunk已正常结束)
+  static constexpr uint16_t kIndexEncrypted = 0x20;  // 索引用chunk的共享密钥加密
   uint64_t magic;
   uint64_t size;
   char pub_key[128];  // 公钥
   char iv[16];
+  crypt::CipherType cipher;
+  compress::CompressType compress;
+  uint16_t flags;
+  uint32_t dict_id;  // zstd字典id, 0为未使用字典
+  char tag[16];  // GCM校验tag
+  uint64_t seq;  // 进程内chunk序号, 崩溃恢复时按序号写出缓存段
+  uint32_t crc;  // 各item的CRC32C依次计算后再接上头部(本字段置0)的CRC32C, 覆盖头部和item结构
+  char reserved2[20];
 
-  ChunkHeader() : magic(kMagic), size(0) {}
+  ChunkHeader()
+      : magic(kMagic),
+        size(0),
+        cipher(crypt::CipherType::kAesCbc),
+        compress(compress::CompressType::kZstd),
+        flags(0),
+        dict_id(0),
+        seq(0),
+        crc(0) {
+    memset(pub_key, 0, sizeof(pub_key));
+    memset(iv, 0, sizeof(iv));
+    memset(tag, 0, sizeof(tag));
+    memset(reserved2, 0, sizeof(reserved2));
+  }
+
+  // 按magic得到头部长度, 无效magic返回0
+  static size_t HeaderSize(uint64_t magic) {
+    if (magic == kLegacyMagic) {
+      return kLegacySize;
+    }
+    return (magic == kMagic || magic == kRawMagic) ? sizeof(ChunkHeader) : 0;
+  }
+
+  // items_crc为各item的CRC32C依次计算的结果
+  uint32_t Checksum(uint32_t items_crc) const {
+    ChunkHeader header = *this;
+    header.crc = 0;
+    return utils::Crc32c(&header, sizeof(header), items_crc);
+  }
 };
 
 struct ItemHeader {
-  static constexpr uint32_t kMagic = 0xbe5fba11;
+  static constexpr uint32_t kMagic = 0xbe5fba11;            // EffectiveMsg记录
+  static constexpr uint32_t kSiteRecordMagic = 0xbe5fba12;  // 携带日志点id的紧凑记录
+  static constexpr uint32_t kSiteTableMagic = 0xbe5fba13;   // 日志点表
+  static constexpr uint32_t kGroupMagic = 0xbe5fba14;       // 批量压缩的一组item, 解压后为未压缩未加密的item序列
+  static constexpr uint32_t kDropMarkerMagic = 0xbe5fba15;  // 丢弃记录标记, 内容为DropMarker
+  static constexpr uint32_t kChunkIndexMagic = 0xbe5fba16;  // chunk索引, 内容为ChunkIndex, 不压缩, 加密时单独用chunk密钥加密
   uint32_t magic;
   uint32_t size;
 
   ItemHeader() : magic(kMagic), size(0) {}
+
+  static bool IsValidMagic(uint32_t magic) { return magic >= kMagic && magic <= kChunkIndexMagic; }
+
+  // chunk中item头部(含kItemCrc的校验)的长度; group item解压后的item序列没有校验
+  static size_t Size(uint16_t chunk_flags) {
+    return sizeof(ItemHeader) + ((chunk_flags & ChunkHeader::kItemCrc) ? sizeof(uint32_t) : 0);
+  }
+
+  // item头部与数据的CRC32C
+  static uint32_t Checksum(const ItemHeader& header, const void* data, size_t size) {
+    return utils::Crc32c(data, size, utils::Crc32c(&header, sizeof(header)));
+  }
+
+  // 追加带校验的item到dest, 返回其校验值
+  static uint32_t AppendChecked(std::string& dest, uint32_t magic, const void* data, size_t size) {
+    ItemHeader header;
+    header.magic = magic;
+    header.size = static_cast<uint32_t>(size);
+    uint32_t crc = Checksum(header, data, size);
+    dest.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    dest.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+    dest.append(static_cast<const char*>(data), size);
+    return crc;
+  }
+};
+
+// 缓存写满时按溢出策略丢弃的记录数, 自上一个标记以来的增量
+struct DropMarker {
+  uint64_t dropped;            // 丢弃的新记录
+  uint64_t dropped_low_level;  // 丢弃的低级别记录
+  uint64_t overwritten;        // 被覆盖的最旧记录
+};
+
+// chunk中记录的摘要, chunk结束时作为最后一个item写入, decoder只解密索引即可按时间范围和级别跳过chunk
+// 记录共用chunk内的压缩流和加密流, chunk是可以单独解码的最小单位, 因此不记录chunk内的偏移
+// 加密的chunk中索引单独以AES-CBC加密(kIndexEncrypted), 不在GCM tag的范围内, 篡改只影响decoder是否跳过chunk
+struct ChunkIndex {
+  static constexpr size_t kLevels = 6;  // kTrace到kFatal
+  static constexpr size_t kIVSize = 16;
+  static constexpr size_t kEncryptedSize = kIVSize + 64;  // 随机IV与补齐到分组长度的密文
+
+  int64_t begin_time;        // 最早记录的时间, 微秒(与EffectiveMsg::timestamp一致)
+  int64_t end_time;          // 最晚记录的时间
+  uint32_t records;          // 记录数
+  uint32_t levels[kLevels];  // 各级别的记录数, 下标为LogLevel
+  uint32_t reserved;
+
+  ChunkIndex() : begin_time(0), end_time(0), records(0), reserved(0) { memset(levels, 0, sizeof(levels)); }
+
+  void Add(int64_t time, LogLevel level) {
+    begin_time = records == 0 ? time : std::min(begin_time, time);
+    end_time = records == 0 ? time : std::max(end_time, time);
+    ++records;
+    if (static_cast<size_t>(level) < kLevels) {
+      ++levels[static_cast<size_t>(level)];
+    }
+  }
+
+  void Merge(const ChunkIndex& other) {
+    if (other.records == 0) {
+      return;
+    }
+    begin_time = records == 0 ? other.begin_time : std::min(begin_time, other.begin_time);
+    end_time = records == 0 ? other.end_time : std::max(end_time, other.end_time);
+    records += other.records;
+    for (size_t i = 0; i < kLevels; ++i) {
+      levels[i] += other.levels[i];
+    }
+  }
+
+  // 索引item的内容大小
+  static size_t PayloadSize(uint16_t chunk_flags) {
+    return (chunk_flags & ChunkHeader::kIndexEncrypted) ? kEncryptedSize : sizeof(ChunkIndex);
+  }
+
+  // 含头部的索引item大小
+  static size_t ItemSize(uint16_t chunk_flags) { return ItemHeader::Size(chunk_flags) + PayloadSize(chunk_flags); }
+
+  // 索引item的内容, key(共享密钥)非空时加密; 加密失败返回空
+  std::string Encode(const std::string& key) const {
+    if (key.empty()) {
+      return std::string(reinterpret_cast<const char*>(this), sizeof(*this));
+    }
+    crypt::AESCrypt crypt(key);  // 构造时生成随机IV
+    std::string payload = crypt.GetIV();
+    std::string encrypted;
+    crypt.Encrypt(this, sizeof(*this), encrypted);
+    payload.append(encrypted);
+    return payload.size() == kEncryptedSize ? payload : std::string();
+  }
+
+  // 带索引的chunk数据(不含ChunkHeader)末尾的索引, 加密的索引用key解密; 没有索引、校验或解密失败时返回false
+  static bool Find(uint16_t chunk_flags, const char* data, size_t size, const std::string& key, ChunkIndex& index) {
+    size_t item_size = ItemSize(chunk_flags);
+    size_t payload_size = PayloadSize(chunk_flags);
+    if (!(chunk_flags & ChunkHeader::kHasIndex) || size < item_size) {
+      return false;
+    }
+    auto item_header = reinterpret_cast<const ItemHeader*>(data + size - item_size);
+    if (item_header->magic != ItemHeader::kChunkIndexMagic || item_header->size != payload_size) {
+      return false;
+    }
+    const char* payload = data + size - payload_size;
+    if (chunk_flags & ChunkHeader::kItemCrc) {
+      uint32_t crc;
+      memcpy(&crc, data + size - item_size + sizeof(ItemHeader), sizeof(crc));
+      if (crc != ItemHeader::Checksum(*item_header, payload, payload_size)) {
+        return false;
+      }
+    }
+    if (!(chunk_flags & ChunkHeader::kIndexEncrypted)) {
+      memcpy(&index, payload, sizeof(index));
+      return true;
+    }
+    if (key.empty()) {
+      return false;
+    }
+    crypt::AESCrypt crypt(key);
+    crypt.SetIV(std::string(payload, kIVSize));
+    std::string plain = crypt.Decrypt(payload + kIVSize, payload_size - kIVSize);
+    if (plain.size() != sizeof(index)) {
+      return false;
+    }
+    memcpy(&index, plain.data(), sizeof(index));
+    return true;
+  }
+};
+static_assert(sizeof(ChunkIndex) == 48, "unexpected ChunkIndex layout");
+
+// 异步模式下环形缓冲区中每条记录的头部, 其后依次为file_name、func_name、message
+// format_fn非空时message为延迟格式化参数的二进制编码
+struct AsyncRecordHeader {
+  int32_t level;
+  int32_t line;
+  uint32_t file_len;
+  uint32_t func_len;
+  uint32_t msg_len;
+  uint32_t fmt_len;
+  uint64_t thread_id;
+  int64_t timestamp;  // system_clock时间点, 纳秒
+  const char* fmt;
+  DeferredArgs::FormatFn format_fn;
+  const LogSite* site;  // 非空时不拷贝file_name和func_name
 };
 
 }  // namespace detail
 
 namespace sink {
+class ColdArchiver;
+
 class EffectiveSink : public Sink {
  public:
+  // 所有缓存段都写满(写文件跟不上)时的处理策略
+  enum class OverflowPolicy {
+    kBlock,           // 阻塞调用线程直到有段写完文件
+    kDrop,            // 丢弃新记录
+    kDropLowLevel,    // 丢弃低于drop_level的新记录, 其余记录阻塞
+    kOverwriteOldest  // 丢弃最旧的尚未开始写文件的段, 复用其空间
+  };
+
+  // 持久化级别, 每一级包含前一级的行为; 级别越高断电时丢失的记录越少, 吞吐越低
+  enum class Durability {
+    kNone,       // 依赖内核回写, 进程崩溃不丢记录, 断电可能丢失最近约30秒(脏页回写周期)的记录
+    kPeriodic,   // 后台每隔sync_interval将缓存段msync并fdatasync当前日志文件, 断电最多丢失一个周期的记录
+    kFileSync,   // 每次缓存段写入日志文件后fdatasync, 已写入文件的记录不会因断电丢失
+    kFatalSync,  // Fatal级别记录在Log返回前msync到缓存文件(异步模式下先处理完环形缓冲区)
+  };
+
   // 保存配置的结构体
   struct Conf {
     std::filesystem::path dir;         // 文件目录
@@ -46,10 +268,53 @@ class EffectiveSink : public Sink {
     std::chrono::minutes interval{5};  // 淘汰间隔
     megabytes single_size{4};          // 单个文件大小
     megabytes total_size{100};         // 总共文件大小
+    bool async{false};                 // 异步模式: 调用线程只拷贝记录, 后台线程格式化/压缩/加密
+    kilobytes ring_size{256};          // 异步模式下每个生产者线程的环形缓冲区大小
+    kilobytes batch_size{0};           // 批量压缩: 记录攒够该大小后整体压缩加密, 0为逐条处理
+    std::chrono::milliseconds batch_interval{100};  // 批量模式下未攒满的批次最长停留时间(进程崩溃时会丢失)
+    crypt::CipherType cipher{crypt::CipherType::kAesCbc};  // 加密方式, CTR/GCM为chunk级流式加密, kNone时无需pub_key
+    compress::CompressType compress{compress::CompressType::kZstd};  // 压缩方式
+    int compress_level{5};  // 压缩级别, zstd为1~19(负数为快速模式), zlib为1~9
+    std::filesystem::path dict_path;  // zstd字典文件(由dict_trainer训练), 为空不使用字典
+    bool adaptive_level{false};  // 按积压自动调整zstd压缩级别: 积压时降到min_level, 空闲时升到max_level
+    int min_level{-5};
+    int max_level{9};
+    bool raw_cache{false};  // 缓存中保存未压缩未加密的记录, 写文件时整个chunk一次性压缩加密(忽略batch_size)
+    size_t cache_segments{2};  // mmap缓存段个数(至少2个), 缓存内存上限约为cache_segments * segment_size
+    kilobytes segment_size{512};  // 每个mmap缓存段的大小
+    uint32_t cache_options{0};  // mmap缓存段的映射选项, mmap::MMapper::MapOption的组合
+    OverflowPolicy overflow_policy{OverflowPolicy::kBlock};  // 缓存段全满时的策略, 异步模式下作用于环形缓冲区满
+    LogLevel drop_level{LogLevel::kWarn};  // kDropLowLevel策略下低于该级别的记录被丢弃
+    Durability durability{Durability::kNone};  // 持久化级别
+    std::chrono::milliseconds sync_interval{1000};  // kPeriodic及以上级别的后台落盘间隔
+    double flush_ratio{0.8};  // 当前段利用率超过该值时切换到下一段并写入文件, 取值(0, 1]
+    std::chrono::milliseconds max_flush_latency{0};  // 记录在缓存段中的最长停留时间, 到时切换非空段写入文件, 0为不限制
+    bool cold_archive{false};  // 轮转后的日志文件由后台空闲优先级线程整体重新压缩(zstd长距离匹配), 仍然加密
+    int cold_level{19};        // 冷归档的zstd压缩级别
+    bool io_uring{false};  // Linux下用io_uring异步写日志文件, 后台线程不阻塞在write/fdatasync上; 不支持时退回同步写
+  };
+
+  // 运行指标
+  struct Metrics {
+    size_t queue_depth{0};  // 异步环形缓冲区中待处理的记录数
+    size_t queue_bytes{0};  // 异步环形缓冲区中待处理的字节数
+    size_t ring_count{0};   // 异步环形缓冲区(生产者线程)个数
+    int compress_level{0};  // 当前实际使用的压缩级别
+    size_t full_segments{0};  // 已写满等待写入文件的缓存段个数
+    uint64_t dropped{0};            // kDrop策略丢弃的记录数
+    uint64_t dropped_low_level{0};  // kDropLowLevel策略丢弃的记录数
+    uint64_t overwritten{0};        // kOverwriteOldest策略覆盖的记录数
+    double flush_ratio{0};  // 生效的切换阈值
+    std::chrono::milliseconds max_flush_latency{0};
+    uint64_t ratio_flushes{0};  // 因利用率超过flush_ratio切换的段数
+    uint64_t timed_flushes{0};  // 因达到max_flush_latency切换的段数
+    uint64_t cold_files{0};        // 已重写为冷归档的文件数
+    uint64_t cold_saved_bytes{0};  // 冷归档节省的磁盘空间
   };
+
   EffectiveSink(Conf conf);
 
-  ~EffectiveSink() override = default;
+  ~EffectiveSink() override;
 
   void Log(const LogMsg& msg) override;
 
@@ -57,36 +322,184 @@ class EffectiveSink : public Sink {
 
   void Flush() override;
 
+  // 异步模式下由后台线程格式化
+  bool SupportDeferred() const override { return conf_.async; }
+
+  Metrics GetMetrics();
+
  private:
-  void SwapCache_();
+  // 日志文件索引中的一项
+  struct LogFile {
+    std::filesystem::path path;
+    size_t size;
+    std::chrono::system_clock::time_point begin;  // 开始写入的时间, 启动时扫描到的文件为最后写入时间
+    std::chrono::system_clock::time_point end;    // 最后写入的时间
+  };
+
+  // 每个生产者线程独占一个环形缓冲区, 后台任务线程是唯一的消费者
+  struct AsyncRing {
+    explicit AsyncRing(size_t capacity) : buffer(capacity) {}
+
+    context::SpscRingBuffer buffer;
+    std::atomic<uint64_t> pushed{0};
+    std::atomic<uint64_t> popped{0};
+    std::atomic<bool> retired{false};  // 生产者线程已退出
+  };
+
+  void LogSync_(const LogMsg& msg);
 
-  bool NeedCacheToFile_();
+  AsyncRing* GetThreadRing_();
 
-  void WriteToCache_(const void* data, uint32_t size);
+  bool PushToRing_(const LogMsg& msg);
+
+  void ScheduleDrain_();
+
+  void DrainRings_();
+
+  mmap::MMapper* ActiveCache_() const { return segments_[active_]->cache.get(); }
+
+  void RecoverCaches_();
+
+  // 校验上次运行遗留的缓存段, 截断到最后一个完整的item并修正chunk头部; 没有完整item时返回false
+  bool RepairCache_(mmap::MMapper& cache);
+
+  void RotateSegment_();
+
+  void WaitActiveFree_(std::unique_lock<std::mutex>& lock);
+
+  bool ShouldDrop_(LogLevel level);
+
+  bool AcquireActive_(std::unique_lock<std::mutex>& lock, LogLevel level);
+
+  bool OverwriteOldest_();
+
+  void WriteDropMarker_();
+
+  void SyncCaches_();
+
+  void CheckCacheToFile_();
+
+  void TimedFlush_();
+
+  double Backlog_() const;
+
+  void StartChunk_();
+
+  int TargetLevel_(double backlog_ratio);
+
+  void AdjustLevel_();
+
+  void FinishChunk_();
+
+  void SealChunk_();
+
+  bool AppendItem_(const std::string& data, uint32_t magic);
+
+  bool FlushBatch_();
+
+  bool WriteItem_(const std::string& data, uint32_t magic);
+
+  // 压缩流和加密流已包含写入失败的item, 结束当前chunk并把其中的记录计入丢弃数
+  void BreakChunk_(const std::string& data, uint32_t magic);
+
+  // 写入一个item后一次性提交, 崩溃时缓存中只有完整的item; 缓存空间不足时回滚并返回false
+  bool WriteToCache_(const void* data, uint32_t size, uint32_t magic);
 
   void PrepareToFile_();
 
-  void CacheToFile_();
+  // wait为true时异步写入的段也要等到写完
+  void CacheToFile_(bool wait = false);
+
+  void SubmitCaches_();
+
+  void ReapCaches_(bool wait);
 
-  std::filesystem::path GetFilePath_();
+  // lost为true时段中的记录没有写入文件, 计入丢弃数
+  void ReleaseSegment_(size_t index, bool lost = false);
+
+  void RegisterCaches_();
+
+  // raw chunk压缩或加密失败时返回false
+  bool WriteCache_(mmap::MMapper& cache);
+
+  bool EncodeRawChunk_(const char* data, size_t size, std::string& dest);
+
+  void ScanLogFiles_();
+
+  bool OpenLogFile_();
 
   void ElimateFiles_();
 
+  void ArchiveFile_(const std::filesystem::path& path);
+
+  void CommitColdFile_(const std::filesystem::path& path, const std::filesystem::path& cold_path, size_t size);
+
  private:
   Conf conf_;
   std::mutex mtx_;
   std::unique_ptr<formatter::Formatter> formatter_;
+  std::unique_ptr<formatter::Formatter> compact_formatter_;
   context::TaskRunnerTag task_runner_;
-  std::unique_ptr<crypt::AESCrypt> crypt_;
+  std::unique_ptr<crypt::AESCrypt> crypt_;  // 不加密时为空
+  std::unique_ptr<crypt::AESStreamCrypt> stream_crypt_;  // 非CBC时使用
+  bool chunk_open_{false};  // 当前段中有本进程开始的流式加密chunk
+  bool chunk_broken_{false};  // 当前chunk因item写入缓存失败已提前结束, 下一条记录前切换到下一段
   std::unique_ptr<compress::Compression> compress_;
-  std::unique_ptr<mmap::MMapper> master_cache_;
-  std::unique_ptr<mmap::MMapper> slave_cache_;
-  std::filesystem::path log_file_path_;
+  std::unique_ptr<compress::Compression> file_compress_;  // 写文件时压缩raw chunk, 只在后台任务线程中使用
+  // 固定大小的mmap缓存段组成的环, 按顺序轮流写入, 写满的段交给后台线程按相同顺序写入文件
+  struct CacheSegment {
+    std::unique_ptr<mmap::MMapper> cache;
+    std::atomic<bool> full{false};
+    bool writing{false};   // 后台线程正在写文件, 不能被覆盖, 受mtx_保护
+    uint64_t records{0};   // 段中的记录数, 受mtx_保护
+    detail::DropMarker drops{};  // 段中丢弃标记的合计, 段被覆盖时需重新标记, 受mtx_保护
+    detail::ChunkIndex index;    // 段中chunk的记录摘要, 受mtx_保护
+    uint32_t items_crc{0};       // 段中chunk各item的CRC32C依次计算的结果, 受mtx_保护
+    std::string encoded;  // 异步写文件时raw chunk的压缩加密结果, 写完前保持有效, 只在后台任务线程中使用
+  };
+  std::vector<std::unique_ptr<CacheSegment>> segments_;
+  size_t active_{0};       // 正在写入记录的段, 受mtx_保护
+  size_t write_index_{0};  // 下一个写入文件的段, 受mtx_保护
+  std::atomic<size_t> full_segments_{0};
+  std::condition_variable segment_cv_;  // 有段写完文件变为空闲时通知
+  std::thread::id runner_thread_id_;
+  std::vector<context::RepeatedTaskId> repeated_tasks_;
+  uint64_t chunk_seq_{0};
+  filesystem::FileWriter file_writer_;  // 当前日志文件, 只在后台任务线程中使用
+  std::string file_time_;  // 最新日志文件名中的时间(%Y%m%d%H%M%S), 只在后台任务线程中使用
+  int file_index_{-1};     // 最新日志文件名中的索引号, -1为没有索引号
+  std::chrono::system_clock::time_point file_begin_;  // 当前日志文件的打开时间
+  // 已关闭的日志文件, 按写入先后排列, 淘汰时从头部删除; 与log_files_bytes_一样只在后台任务线程中使用
+  std::deque<LogFile> log_files_;
+  size_t log_files_bytes_{0};
+  std::vector<filesystem::FileWriter::Buffer> registered_caches_;  // 最近一次注册固定缓冲区时的缓存段范围
+  std::atomic<bool> closing_{false};  // 析构中, 异步写入不再投递回收任务
   std::string client_pub_key_;
+  std::string shared_secret_;  // 加密chunk索引
   std::string compressed_buf_;
   std::string encryped_buf_;
   std::string aes_crypt_iv_;
-  std::atomic<bool> is_slave_free_{true};
+  std::string site_table_buf_;
+  std::string batch_buf_;
+  std::string file_compressed_buf_;  // 以下两个缓冲区只在后台任务线程中使用
+  std::string file_chunk_buf_;
+  uint32_t sites_written_{0};  // 当前chunk已写入的日志点个数
+  uint32_t items_since_adjust_{0};
+  std::atomic<int> compress_level_{0};
+  std::atomic<uint64_t> dropped_{0};
+  std::atomic<uint64_t> dropped_low_level_{0};
+  std::atomic<uint64_t> overwritten_{0};
+  std::atomic<uint64_t> ratio_flushes_{0};
+  std::atomic<uint64_t> timed_flushes_{0};
+  std::unique_ptr<ColdArchiver> cold_archiver_;  // 未开启冷归档时为空
+  context::TaskRunnerTag cold_runner_;
+  std::atomic<uint64_t> cold_files_{0};
+  std::atomic<uint64_t> cold_saved_bytes_{0};
+  detail::DropMarker reported_drops_{};  // 已写入标记的丢弃数, 受mtx_保护
+  uint64_t sink_id_;
+  std::mutex rings_mtx_;
+  std::vector<std::shared_ptr<AsyncRing>> rings_;
+  std::atomic<bool> drain_scheduled_{false};
 };
 
 }  // namespace sink
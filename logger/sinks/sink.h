@@ -16,6 +16,9 @@ class Sink {
   virtual void SetFormatter(std::unique_ptr<formatter::Formatter> formatter) = 0;
 
   virtual void Flush() {}
+
+  // 是否能处理未格式化的LogMsg(msg.deferred非空), 不支持的sink由Logger格式化后再传入
+  virtual bool SupportDeferred() const { return false; }
 };
 
 }  // namespace sink
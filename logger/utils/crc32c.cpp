@@ -0,0 +1,132 @@
+#include "utils/crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOGGER_CRC32C_SSE42 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#define LOGGER_CRC32C_ARM 1
+#include <arm_acle.h>
+#endif
+
+namespace logger {
+namespace utils {
+
+namespace {
+
+// 反射形式的CRC32C多项式
+constexpr uint32_t kCrc32cPoly = 0x82f63b78;
+
+// slicing-by-8查表, 每次处理8字节
+struct Crc32cTable {
+  uint32_t table[8][256];
+
+  constexpr Crc32cTable() : table() {
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPoly : 0);
+      }
+      table[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (int k = 1; k < 8; ++k) {
+        table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xff];
+      }
+    }
+  }
+};
+
+constexpr Crc32cTable kCrc32cTable;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+constexpr bool kLittleEndian = false;
+#else
+constexpr bool kLittleEndian = true;
+#endif
+
+uint32_t SoftwareCrc32c(const uint8_t* data, size_t size, uint32_t crc) {
+  auto& t = kCrc32cTable.table;
+  // 8字节一组按小端解释, 大端平台逐字节计算
+  while (kLittleEndian && size >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    word ^= crc;
+    crc = t[7][word & 0xff] ^ t[6][(word >> 8) & 0xff] ^ t[5][(word >> 16) & 0xff] ^ t[4][(word >> 24) & 0xff] ^
+          t[3][(word >> 32) & 0xff] ^ t[2][(word >> 40) & 0xff] ^ t[1][(word >> 48) & 0xff] ^ t[0][word >> 56];
+    data += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xff];
+  }
+  return crc;
+}
+
+#if defined(LOGGER_CRC32C_SSE42)
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("sse4.2")))
+#endif
+uint32_t HardwareCrc32c(const uint8_t* data, size_t size, uint32_t crc) {
+  uint64_t crc64 = crc;
+  while (size >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += 8;
+    size -= 8;
+  }
+  crc = static_cast<uint32_t>(crc64);
+  while (size-- > 0) {
+    crc = _mm_crc32_u8(crc, *data++);
+  }
+  return crc;
+}
+
+bool HasHardwareCrc32c() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 20)) != 0;
+#else
+  return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#elif defined(LOGGER_CRC32C_ARM)
+uint32_t HardwareCrc32c(const uint8_t* data, size_t size, uint32_t crc) {
+  while (size >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    crc = __crc32cd(crc, word);
+    data += 8;
+    size -= 8;
+  }
+  while (size-- > 0) {
+    crc = __crc32cb(crc, *data++);
+  }
+  return crc;
+}
+
+bool HasHardwareCrc32c() { return true; }
+#endif
+
+}  // namespace
+
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc) {
+  auto bytes = static_cast<const uint8_t*>(data);
+  crc = ~crc;
+#if defined(LOGGER_CRC32C_SSE42) || defined(LOGGER_CRC32C_ARM)
+  static const bool kHardware = HasHardwareCrc32c();
+  if (kHardware) {
+    return ~HardwareCrc32c(bytes, size, crc);
+  }
+#endif
+  return ~SoftwareCrc32c(bytes, size, crc);
+}
+
+}  // namespace utils
+}  // namespace logger
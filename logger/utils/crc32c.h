@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace logger {
+namespace utils {
+
+// CRC32C(Castagnoli), crc为之前数据的结果, 可分段连续计算
+// x86-64使用SSE4.2的crc32指令(运行时检测), 编译目标支持ARMv8 CRC扩展时使用crc32c指令, 否则查表计算
+uint32_t Crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+}  // namespace utils
+}  // namespace logger
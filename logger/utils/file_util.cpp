@@ -1,5 +1,8 @@
 #include "utils/file_util.h"
 
+#include <fstream>
+#include <sstream>
+
 namespace logger {
 namespace filesystem {
 size_t GetFileSize(const std::filesystem::path& file_path) {
@@ -8,5 +11,15 @@ size_t GetFileSize(const std::filesystem::path& file_path) {
   }
   return 0;
 }
+
+std::string ReadFile(const std::filesystem::path& file_path) {
+  std::ifstream ifs(file_path, std::ios::binary);
+  if (!ifs) {
+    return "";
+  }
+  std::ostringstream oss;
+  oss << ifs.rdbuf();
+  return oss.str();
+}
 }  // namespace filesystem
 }  // namespace logger
\ No newline at end of file
@@ -2,9 +2,12 @@
 
 #include <stdint.h>
 #include <filesystem>
+#include <string>
 
 namespace logger {
 namespace filesystem {
 size_t GetFileSize(const std::filesystem::path& file_path);
+// 读取整个文件, 失败返回空字符串
+std::string ReadFile(const std::filesystem::path& file_path);
 }  // namespace filesystem
 }  // namespace logger
\ No newline at end of file
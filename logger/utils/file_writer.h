@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace logger {
+namespace filesystem {
+
+/**
+ * @brief 追加写日志文件, 文件在轮转前保持打开
+ *
+ * 文件大小记录在内存中, 写入使用pwrite/pwritev, 不再每次写入都打开文件和stat。
+ * 打开时按preallocate预分配磁盘空间(不改变文件大小, 进程崩溃时文件中没有空洞),
+ * 关闭时截断到实际大小以释放未使用的预分配空间。
+ * 启用异步写入后(Linux io_uring), WriteAsync只提交写请求, 完成情况由Reap按提交顺序返回;
+ * 不支持io_uring时WriteAsync同步完成, 调用方无需区分。
+ * 非线程安全, 由EffectiveSink的后台任务线程独占使用。
+ */
+class FileWriter {
+ public:
+  // 一次写入中的一段数据
+  struct Buffer {
+    const void* data;
+    size_t size;
+  };
+
+  FileWriter();
+  ~FileWriter();
+
+  FileWriter(const FileWriter&) = delete;
+  FileWriter& operator=(const FileWriter&) = delete;
+
+  // 打开(不存在则创建)文件并追加到末尾, preallocate为0时不预分配
+  bool Open(const std::filesystem::path& file_path, size_t preallocate);
+
+  // 等待未完成的异步写入后关闭文件
+  void Close();
+
+  bool IsOpen() const;
+
+  // 按顺序追加多段数据, 失败返回false
+  bool Write(const Buffer* buffers, size_t count);
+
+  bool Write(const void* data, size_t size) {
+    Buffer buffer{data, size};
+    return Write(&buffer, 1);
+  }
+
+  // 追加src_handle文件中从src_offset开始的size字节, data为这段内容在内存中的映射
+  // Linux下在内核中拷贝(copy_file_range/sendfile), 不经过用户态; src_handle为-1或不支持时写入data
+  bool CopyFrom(intptr_t src_handle, size_t src_offset, const void* data, size_t size);
+
+  // 已写入内容落盘(fdatasync)
+  bool Sync();
+
+  // 尝试启用io_uring异步写入, 内核不支持或被禁止(如seccomp)时返回false
+  bool EnableAsync(unsigned queue_depth);
+
+  bool IsAsync() const;
+
+  // 注册固定缓冲区, 数据落在其中的异步写入不必每次映射用户内存; 不支持(如普通文件的mmap)时返回false
+  bool RegisterBuffers(const std::vector<Buffer>& buffers);
+
+  // 异步追加data, 完成前data必须保持有效; sync为true时写入后fdatasync; 完成后token由Reap返回
+  // 文件未打开时返回false, 写入出错记录日志后仍按完成处理
+  bool WriteAsync(const void* data, size_t size, bool sync, uint64_t token);
+
+  // 按提交顺序取出已完成的异步写入, wait为true且有未完成写入时至少等待一个完成
+  void Reap(std::vector<uint64_t>& tokens, bool wait);
+
+  size_t PendingWrites() const { return pending_.size(); }
+
+  const std::filesystem::path& Path() const { return file_path_; }
+
+  size_t Size() const { return size_; }
+
+ private:
+  // 一次已提交的异步写入
+  struct PendingWrite {
+    uint64_t token;
+    const void* data;
+    size_t size;
+    size_t offset;
+    intptr_t handle;
+    bool sync;
+    int completions;  // 尚未收到的完成事件个数(写入以及链接的fdatasync)
+  };
+
+  struct Uring;
+
+  // CopyFrom使用的拷贝方式, 不支持时降级
+  enum CopyMode : uint8_t { kCopyFileRange, kCopySendfile, kCopyNone };
+
+  // 处理已到达的完成事件, wait为true时至少等待一个
+  void Complete_(bool wait);
+
+  std::filesystem::path file_path_;
+  intptr_t handle_{-1};  // Linux下为fd, Windows下为HANDLE
+  size_t size_{0};
+  std::unique_ptr<Uring> uring_;
+  std::deque<PendingWrite> pending_;
+  CopyMode copy_mode_{kCopyFileRange};
+  uint64_t first_pending_id_{0};  // pending_首个元素的提交序号, 作为完成事件的user_data
+};
+
+}  // namespace filesystem
+}  // namespace logger
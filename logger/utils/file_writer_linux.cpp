@@ -0,0 +1,456 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/sendfile.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "helpers/internal_log.h"
+#include "utils/file_writer.h"
+
+// Linux版本使用POSIX API
+
+namespace logger {
+namespace filesystem {
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+
+// 直接使用io_uring系统调用的最小实现: 一个提交队列和一个完成队列
+struct FileWriter::Uring {
+  int fd{-1};
+  unsigned entries{0};
+  unsigned to_submit{0};  // 已放入提交队列尚未调用io_uring_enter的请求数
+  unsigned inflight{0};   // 已放入提交队列尚未收到完成事件的请求数
+  void* sq_ptr{MAP_FAILED};
+  size_t sq_size{0};
+  void* cq_ptr{MAP_FAILED};
+  size_t cq_size{0};
+  io_uring_sqe* sqes{static_cast<io_uring_sqe*>(MAP_FAILED)};
+  size_t sqes_size{0};
+  unsigned* sq_head{nullptr};
+  unsigned* sq_tail{nullptr};
+  unsigned* sq_mask{nullptr};
+  unsigned* sq_array{nullptr};
+  unsigned* cq_head{nullptr};
+  unsigned* cq_tail{nullptr};
+  unsigned* cq_mask{nullptr};
+  io_uring_cqe* cqes{nullptr};
+  std::vector<Buffer> registered;
+
+  ~Uring() {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) {
+      munmap(cq_ptr, cq_size);
+    }
+    if (sq_ptr != MAP_FAILED) {
+      munmap(sq_ptr, sq_size);
+    }
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+
+  bool Setup(unsigned queue_depth) {
+    io_uring_params params = {};
+    fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+    if (fd < 0) {
+      fd = -1;
+      return false;
+    }
+    entries = params.sq_entries;
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_size = cq_size = std::max(sq_size, cq_size);
+    }
+    sq_ptr = mmap(nullptr, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (sq_ptr == MAP_FAILED) {
+      return false;
+    }
+    cq_ptr = single_mmap ? sq_ptr
+                         : mmap(nullptr, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                IORING_OFF_CQ_RING);
+    if (cq_ptr == MAP_FAILED) {
+      return false;
+    }
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe*>(
+        mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES));
+    if (sqes == MAP_FAILED) {
+      return false;
+    }
+    auto sq = static_cast<char*>(sq_ptr);
+    sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    auto cq = static_cast<char*>(cq_ptr);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // 取一个空闲的提交项, 调用方保证inflight不超过entries
+  io_uring_sqe* NextSqe() {
+    unsigned tail = *sq_tail;
+    unsigned index = tail & *sq_mask;
+    io_uring_sqe* sqe = &sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit;
+    ++inflight;
+    return sqe;
+  }
+
+  // 提交请求, min_complete大于0时等待完成事件
+  bool Enter(unsigned min_complete) {
+    while (true) {
+      unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+      int ret = static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+      if (ret >= 0) {
+        to_submit -= std::min<unsigned>(to_submit, ret);
+        return true;
+      }
+      if (errno != EINTR) {
+        return false;
+      }
+    }
+  }
+};
+
+bool FileWriter::EnableAsync(unsigned queue_depth) {
+  if (uring_) {
+    return true;
+  }
+  auto uring = std::make_unique<Uring>();
+  if (!uring->Setup(queue_depth)) {
+    LOG_INFO("FileWriter::EnableAsync: io_uring unavailable, errno {}", errno);
+    return false;
+  }
+  uring_ = std::move(uring);
+  return true;
+}
+
+bool FileWriter::RegisterBuffers(const std::vector<Buffer>& buffers) {
+  if (!uring_) {
+    return false;
+  }
+  if (!uring_->registered.empty()) {
+    syscall(__NR_io_uring_register, uring_->fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+    uring_->registered.clear();
+  }
+  std::vector<iovec> iovs;
+  for (auto& buffer : buffers) {
+    iovs.push_back({const_cast<void*>(buffer.data), buffer.size});
+  }
+  if (syscall(__NR_io_uring_register, uring_->fd, IORING_REGISTER_BUFFERS, iovs.data(), iovs.size()) != 0) {
+    LOG_INFO("FileWriter::RegisterBuffers: register failed, errno {}", errno);
+    return false;
+  }
+  uring_->registered = buffers;
+  return true;
+}
+
+bool FileWriter::WriteAsync(const void* data, size_t size, bool sync, uint64_t token) {
+  if (handle_ == -1) {
+    return false;
+  }
+  if (!uring_) {
+    size_t offset = size_;
+    if (Write(data, size) && sync) {
+      Sync();
+    }
+    pending_.push_back({token, data, size, offset, handle_, sync, 0});
+    return true;
+  }
+  // 完成队列容量为提交队列的两倍, 限制在途请求数避免完成事件溢出
+  int completions = sync ? 2 : 1;
+  while (uring_->inflight + completions > uring_->entries) {
+    Complete_(true);
+  }
+  uint64_t id = first_pending_id_ + pending_.size();
+  pending_.push_back({token, data, size, size_, handle_, sync, completions});
+
+  io_uring_sqe* sqe = uring_->NextSqe();
+  sqe->opcode = IORING_OP_WRITE;
+  sqe->fd = static_cast<int>(handle_);
+  sqe->addr = reinterpret_cast<uint64_t>(data);
+  sqe->len = static_cast<uint32_t>(size);
+  sqe->off = size_;
+  sqe->user_data = id << 1;
+  auto& registered = uring_->registered;
+  for (size_t i = 0; i < registered.size(); ++i) {
+    auto begin = static_cast<const char*>(registered[i].data);
+    if (data >= begin && static_cast<const char*>(data) + size <= begin + registered[i].size) {
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->buf_index = static_cast<uint16_t>(i);
+      break;
+    }
+  }
+  if (sync) {
+    // 写入成功后才执行fdatasync, 写入失败或不完整时fdatasync被取消
+    sqe->flags |= IOSQE_IO_LINK;
+    io_uring_sqe* sync_sqe = uring_->NextSqe();
+    sync_sqe->opcode = IORING_OP_FSYNC;
+    sync_sqe->fd = static_cast<int>(handle_);
+    sync_sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sync_sqe->user_data = (id << 1) | 1;
+  }
+  size_ += size;
+  // 提交失败的请求留在队列中, 下次Complete_时再提交
+  if (!uring_->Enter(0)) {
+    LOG_ERROR("FileWriter::WriteAsync: io_uring_enter failed, errno {}", errno);
+  }
+  return true;
+}
+
+void FileWriter::Complete_(bool wait) {
+  if (!uring_ || (uring_->inflight == 0 && uring_->to_submit == 0)) {
+    return;
+  }
+  if (!uring_->Enter(wait ? 1 : 0)) {
+    LOG_ERROR("FileWriter::Complete_: io_uring_enter failed, errno {}", errno);
+    return;
+  }
+  unsigned head = *uring_->cq_head;
+  unsigned tail = __atomic_load_n(uring_->cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    io_uring_cqe* cqe = &uring_->cqes[head & *uring_->cq_mask];
+    --uring_->inflight;
+    PendingWrite& write = pending_[(cqe->user_data >> 1) - first_pending_id_];
+    --write.completions;
+    bool is_sync = cqe->user_data & 1;
+    if (!is_sync && cqe->res != static_cast<int>(write.size)) {
+      // 写入失败或不完整(如内核不支持IORING_OP_WRITE), 剩余部分同步写入
+      size_t written = cqe->res > 0 ? cqe->res : 0;
+      auto data = static_cast<const char*>(write.data);
+      while (written < write.size) {
+        ssize_t ret = pwrite(static_cast<int>(write.handle), data + written, write.size - written, write.offset + written);
+        if (ret < 0 && errno == EINTR) {
+          continue;
+        }
+        if (ret <= 0) {
+          LOG_ERROR("FileWriter::Complete_: write {} failed, errno {}", file_path_.string(), errno);
+          break;
+        }
+        written += ret;
+      }
+    } else if (is_sync && cqe->res < 0) {
+      // 链接的fdatasync因写入不完整被取消或执行失败, 同步补做
+      fdatasync(static_cast<int>(write.handle));
+    }
+  }
+  __atomic_store_n(uring_->cq_head, head, __ATOMIC_RELEASE);
+}
+
+#else
+
+struct FileWriter::Uring {};
+
+bool FileWriter::EnableAsync(unsigned queue_depth) {
+  return false;
+}
+
+bool FileWriter::RegisterBuffers(const std::vector<Buffer>& buffers) {
+  return false;
+}
+
+bool FileWriter::WriteAsync(const void* data, size_t size, bool sync, uint64_t token) {
+  if (handle_ == -1) {
+    return false;
+  }
+  size_t offset = size_;
+  if (Write(data, size) && sync) {
+    Sync();
+  }
+  pending_.push_back({token, data, size, offset, handle_, sync, 0});
+  return true;
+}
+
+void FileWriter::Complete_(bool wait) {}
+
+#endif
+
+FileWriter::FileWriter() = default;
+
+FileWriter::~FileWriter() {
+  Close();
+}
+
+bool FileWriter::IsAsync() const {
+  return uring_ != nullptr;
+}
+
+void FileWriter::Reap(std::vector<uint64_t>& tokens, bool wait) {
+  Complete_(false);
+  while (wait && !pending_.empty() && pending_.front().completions > 0) {
+    Complete_(true);
+  }
+  while (!pending_.empty() && pending_.front().completions == 0) {
+    tokens.push_back(pending_.front().token);
+    pending_.pop_front();
+    ++first_pending_id_;
+  }
+}
+
+bool FileWriter::Open(const std::filesystem::path& file_path, size_t preallocate) {
+  Close();
+  int fd = open(file_path.string().c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if (fd == -1) {
+    LOG_ERROR("FileWriter::Open: open {} failed, errno {}", file_path.string(), errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    close(fd);
+    return false;
+  }
+  handle_ = fd;
+  file_path_ = file_path;
+  size_ = static_cast<size_t>(st.st_size);
+#if defined(__linux__)
+  // 只分配磁盘块不改变文件大小, 失败(如文件系统不支持)不影响写入
+  if (preallocate > size_) {
+    fallocate(fd, FALLOC_FL_KEEP_SIZE, size_, preallocate - size_);
+  }
+#endif
+  return true;
+}
+
+void FileWriter::Close() {
+  if (handle_ == -1) {
+    return;
+  }
+  // 异步写入全部完成后才能截断和关闭, 完成的写入仍由Reap返回
+  // io_uring的完成事件不保证顺序, 最后一个写入完成时之前的写入或链接的fdatasync可能还在进行
+  auto in_flight = [this]() {
+    return std::any_of(pending_.begin(), pending_.end(),
+                       [](const PendingWrite& write) { return write.completions > 0; });
+  };
+  while (in_flight()) {
+    Complete_(true);
+  }
+  int fd = static_cast<int>(handle_);
+  // 释放超出实际大小的预分配空间
+  if (ftruncate(fd, size_) != 0) {
+    LOG_ERROR("FileWriter::Close: truncate {} failed, errno {}", file_path_.string(), errno);
+  }
+  close(fd);
+  handle_ = -1;
+}
+
+bool FileWriter::IsOpen() const {
+  return handle_ != -1;
+}
+
+bool FileWriter::Write(const Buffer* buffers, size_t count) {
+  if (handle_ == -1) {
+    return false;
+  }
+  std::vector<iovec> iovs;
+  iovs.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    if (buffers[i].size > 0) {
+      iovs.push_back({const_cast<void*>(buffers[i].data), buffers[i].size});
+    }
+  }
+  // 部分写入时跳过已写入的部分继续写
+  size_t index = 0;
+  while (index < iovs.size()) {
+    int iov_count = static_cast<int>(std::min<size_t>(iovs.size() - index, IOV_MAX));
+    ssize_t written = pwritev(static_cast<int>(handle_), iovs.data() + index, iov_count, size_);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_ERROR("FileWriter::Write: write {} failed, errno {}", file_path_.string(), errno);
+      return false;
+    }
+    size_ += written;
+    while (written > 0) {
+      size_t consumed = std::min<size_t>(written, iovs[index].iov_len);
+      iovs[index].iov_base = static_cast<char*>(iovs[index].iov_base) + consumed;
+      iovs[index].iov_len -= consumed;
+      written -= consumed;
+      if (iovs[index].iov_len == 0) {
+        ++index;
+      }
+    }
+  }
+  return true;
+}
+
+bool FileWriter::CopyFrom(intptr_t src_handle, size_t src_offset, const void* data, size_t size) {
+  if (handle_ == -1) {
+    return false;
+  }
+  size_t copied = 0;
+#if defined(__linux__)
+  // 内核中拷贝: 优先copy_file_range, 不支持(如跨文件系统)时用sendfile, 都不支持后不再尝试
+  int src = copy_mode_ == kCopyNone ? -1 : static_cast<int>(src_handle);
+  int dst = static_cast<int>(handle_);
+  while (src != -1 && copied < size) {
+    ssize_t ret = 0;
+    if (copy_mode_ == kCopyFileRange) {
+      loff_t in_offset = src_offset + copied;
+      loff_t out_offset = size_ + copied;
+      ret = copy_file_range(src, &in_offset, dst, &out_offset, size - copied, 0);
+      if (ret < 0 && copied == 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+        copy_mode_ = kCopySendfile;
+        continue;
+      }
+    } else {
+      // sendfile写到文件当前位置
+      off_t in_offset = src_offset + copied;
+      if (lseek(dst, size_ + copied, SEEK_SET) < 0) {
+        break;
+      }
+      ret = sendfile(dst, src, &in_offset, size - copied);
+      if (ret < 0 && copied == 0 && (errno == EINVAL || errno == ENOSYS)) {
+        copy_mode_ = kCopyNone;
+        break;
+      }
+    }
+    if (ret < 0 && errno == EINTR) {
+      continue;
+    }
+    if (ret <= 0) {
+      break;
+    }
+    copied += ret;
+  }
+#endif
+  size_ += copied;
+  // 未能在内核中拷贝的部分从映射的内存写入
+  return copied == size || Write(static_cast<const char*>(data) + copied, size - copied);
+}
+
+bool FileWriter::Sync() {
+  if (handle_ == -1) {
+    return false;
+  }
+#if defined(__APPLE__)
+  return fsync(static_cast<int>(handle_)) == 0;
+#else
+  return fdatasync(static_cast<int>(handle_)) == 0;
+#endif
+}
+
+}  // namespace filesystem
+}  // namespace logger
@@ -0,0 +1,126 @@
+#include <windows.h>
+
+#include <algorithm>
+
+#include "helpers/internal_log.h"
+#include "utils/file_writer.h"
+
+// Windows版本使用Win32 API
+
+namespace logger {
+namespace filesystem {
+
+// Windows下不提供异步写入, WriteAsync同步完成
+struct FileWriter::Uring {};
+
+FileWriter::FileWriter() = default;
+
+FileWriter::~FileWriter() {
+  Close();
+}
+
+bool FileWriter::EnableAsync(unsigned queue_depth) {
+  return false;
+}
+
+bool FileWriter::IsAsync() const {
+  return false;
+}
+
+bool FileWriter::RegisterBuffers(const std::vector<Buffer>& buffers) {
+  return false;
+}
+
+bool FileWriter::WriteAsync(const void* data, size_t size, bool sync, uint64_t token) {
+  if (handle_ == -1) {
+    return false;
+  }
+  size_t offset = size_;
+  if (Write(data, size) && sync) {
+    Sync();
+  }
+  pending_.push_back({token, data, size, offset, handle_, sync, 0});
+  return true;
+}
+
+void FileWriter::Reap(std::vector<uint64_t>& tokens, bool wait) {
+  while (!pending_.empty()) {
+    tokens.push_back(pending_.front().token);
+    pending_.pop_front();
+    ++first_pending_id_;
+  }
+}
+
+void FileWriter::Complete_(bool wait) {}
+
+bool FileWriter::Open(const std::filesystem::path& file_path, size_t preallocate) {
+  Close();
+  HANDLE handle = CreateFileW(file_path.wstring().c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                              OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (handle == INVALID_HANDLE_VALUE) {
+    LOG_ERROR("FileWriter::Open: open {} failed, error {}", file_path.string(), GetLastError());
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(handle, &file_size)) {
+    CloseHandle(handle);
+    return false;
+  }
+  handle_ = reinterpret_cast<intptr_t>(handle);
+  file_path_ = file_path;
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  // 预分配需要改变文件大小, 为保证崩溃时文件中没有空洞, Windows下不预分配
+  (void)preallocate;
+  return true;
+}
+
+void FileWriter::Close() {
+  if (handle_ == -1) {
+    return;
+  }
+  CloseHandle(reinterpret_cast<HANDLE>(handle_));
+  handle_ = -1;
+}
+
+bool FileWriter::IsOpen() const {
+  return handle_ != -1;
+}
+
+bool FileWriter::Write(const Buffer* buffers, size_t count) {
+  if (handle_ == -1) {
+    return false;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    auto data = static_cast<const char*>(buffers[i].data);
+    size_t left = buffers[i].size;
+    while (left > 0) {
+      OVERLAPPED overlapped = {};
+      overlapped.Offset = static_cast<DWORD>(size_ & 0xffffffff);
+      overlapped.OffsetHigh = static_cast<DWORD>(static_cast<uint64_t>(size_) >> 32);
+      DWORD written = 0;
+      DWORD to_write = static_cast<DWORD>(std::min<size_t>(left, 1 << 30));
+      if (!WriteFile(reinterpret_cast<HANDLE>(handle_), data, to_write, &written, &overlapped)) {
+        LOG_ERROR("FileWriter::Write: write {} failed, error {}", file_path_.string(), GetLastError());
+        return false;
+      }
+      data += written;
+      left -= written;
+      size_ += written;
+    }
+  }
+  return true;
+}
+
+bool FileWriter::CopyFrom(intptr_t src_handle, size_t src_offset, const void* data, size_t size) {
+  return Write(data, size);
+}
+
+bool FileWriter::Sync() {
+  if (handle_ == -1) {
+    return false;
+  }
+  return FlushFileBuffers(reinterpret_cast<HANDLE>(handle_));
+}
+
+}  // namespace filesystem
+}  // namespace logger
@@ -12,6 +12,8 @@ size_t GetProcessID();
 size_t GetPageSize();
 size_t GetThreadID();
 void LocalTime(std::tm* tm, std::time_t* now);
+// 当前线程的CPU和IO调度降为空闲优先级, 只在系统空闲时运行
+void SetIdlePriority();
 
 }  // namespace utils
 }  // namespace logger
@@ -1,5 +1,7 @@
 
 
+#include <pthread.h>
+#include <sys/resource.h>
 #include <sys/syscall.h>
 #include <unistd.h>
 
@@ -29,5 +31,21 @@ void LocalTime(std::tm* tm, std::time_t* now) {
   localtime_r(now, tm);
 }
 
+void SetIdlePriority() {
+#if defined(__linux__)
+  sched_param param = {};
+  pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+#if defined(SYS_ioprio_set)
+  // ioprio_set(IOPRIO_WHO_PROCESS, 0, IOPRIO_CLASS_IDLE), who为0时作用于当前线程
+  constexpr int kIoprioWhoProcess = 1;
+  constexpr int kIoprioClassIdle = 3;
+  constexpr int kIoprioClassShift = 13;
+  ::syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift);
+#endif
+#elif defined(__APPLE__)
+  setpriority(PRIO_DARWIN_THREAD, 0, PRIO_DARWIN_BG);
+#endif
+}
+
 }  // namespace utils
 }  // namespace logger
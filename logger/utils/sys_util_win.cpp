@@ -26,5 +26,9 @@ void LocalTime(std::tm* tm, std::time_t* now) {
   localtime_s(tm, now);
 }
 
+void SetIdlePriority() {
+  SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN);
+}
+
 }  // namespace utils
 }  // namespace logger
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include "fmt/core.h"
 #include "fmt/base.h"
 
+#include "formatter/arg_codec.h"
 #include "logger.h"
 
 namespace logger
@@ -16,7 +17,13 @@ class VariadicLogger : public Logger {
 
   template <typename... Args>
   void Log(SourceLocation loc, LogLevel lvl, fmt::format_string<Args...> fmt, Args&&... args) {
-    Log_(loc, lvl, fmt, std::forward<Args>(args)...);
+    Log_(nullptr, loc, lvl, fmt, std::forward<Args>(args)...);
+  }
+
+  // 由LOGGER_CALL宏调用, 位置与级别来自静态注册的日志点
+  template <typename... Args>
+  void Log(const LogSite& site, fmt::format_string<Args...> fmt, Args&&... args) {
+    Log_(&site, site.location, site.level, fmt, std::forward<Args>(args)...);
   }
 
   template <typename... Args>
@@ -24,16 +31,48 @@ class VariadicLogger : public Logger {
     Log(SourceLocation{}, lvl, fmt, std::forward<Args>(args)...);
   }
 
+  // 开启后调用处只编码参数, 格式化推迟到sink的后台线程(需配合EffectiveSink异步模式)
+  // 日志点的字面量格式串只传递指针, 其他格式串随参数拷贝; 参数包含无法编码的类型时仍在调用处格式化
+  void SetDeferredFormat(bool deferred) { deferred_format_.store(deferred, std::memory_order_relaxed); }
+
  private:
   template <typename... Args>
-  void Log_(SourceLocation loc, LogLevel lvl, fmt::basic_string_view<char> fmt, Args&&... args) {
+  void Log_(const LogSite* site,
+            SourceLocation loc,
+            LogLevel lvl,
+            fmt::basic_string_view<char> fmt,
+            Args&&... args) {
     if (!ShouldLog_(lvl)) {
       return;
     }
+    if constexpr (formatter::kIsDeferrable<Args...>) {
+      if (deferred_format_.load(std::memory_order_relaxed)) {
+        static thread_local std::string data;
+        data.clear();
+        DeferredArgs deferred;
+        // 只有日志点记录的字面量格式串在后台格式化时仍然有效, 运行时字符串编码在参数之前
+        if (site && !site->fmt.empty()) {
+          deferred.fmt = StringView(fmt.data(), fmt.size());
+        } else {
+          formatter::EncodeArg(std::string_view(fmt.data(), fmt.size()), data);
+        }
+        formatter::EncodeArgs(data, args...);
+        deferred.data = data;
+        deferred.format_fn = &formatter::FormatDeferred<Args...>;
+        LogMsg msg(loc, lvl, StringView());
+        msg.deferred = &deferred;
+        msg.site = site;
+        Logger::Log_(msg);
+        return;
+      }
+    }
     fmt::basic_memory_buffer<char, 256> buf;
     fmt::detail::vformat_to(buf, fmt, fmt::make_format_args(std::forward<Args>(args)...));
     LogMsg msg(loc, lvl, StringView(buf.data(), buf.size()));
+    msg.site = site;
     Logger::Log_(msg);
   }
+
+  std::atomic<bool> deferred_format_{false};
 };
 } // namespace logger